@@ -0,0 +1,78 @@
+#include "midi_audio_output.h"
+
+#include <godot_cpp/classes/audio_stream_player.hpp>
+#include <godot_cpp/classes/audio_stream_player2d.hpp>
+#include <godot_cpp/classes/audio_stream_player3d.hpp>
+
+namespace godot {
+
+MidiAudioOutput::MidiAudioOutput(Node *p_node) :
+		node(p_node) {
+	player = Object::cast_to<AudioStreamPlayer>(p_node);
+	player_2d = Object::cast_to<AudioStreamPlayer2D>(p_node);
+	player_3d = Object::cast_to<AudioStreamPlayer3D>(p_node);
+}
+
+void MidiAudioOutput::set_stream(const Ref<AudioStream> &p_stream) {
+	if (player) {
+		player->set_stream(p_stream);
+	} else if (player_2d) {
+		player_2d->set_stream(p_stream);
+	} else if (player_3d) {
+		player_3d->set_stream(p_stream);
+	}
+}
+
+void MidiAudioOutput::set_bus(const StringName &p_bus) {
+	if (player) {
+		player->set_bus(p_bus);
+	} else if (player_2d) {
+		player_2d->set_bus(p_bus);
+	} else if (player_3d) {
+		player_3d->set_bus(p_bus);
+	}
+}
+
+void MidiAudioOutput::play() {
+	if (player) {
+		player->play();
+	} else if (player_2d) {
+		player_2d->play();
+	} else if (player_3d) {
+		player_3d->play();
+	}
+}
+
+void MidiAudioOutput::stop() {
+	if (player) {
+		player->stop();
+	} else if (player_2d) {
+		player_2d->stop();
+	} else if (player_3d) {
+		player_3d->stop();
+	}
+}
+
+bool MidiAudioOutput::is_playing() const {
+	if (player) {
+		return player->is_playing();
+	} else if (player_2d) {
+		return player_2d->is_playing();
+	} else if (player_3d) {
+		return player_3d->is_playing();
+	}
+	return false;
+}
+
+Ref<AudioStreamPlayback> MidiAudioOutput::get_stream_playback() const {
+	if (player) {
+		return player->get_stream_playback();
+	} else if (player_2d) {
+		return player_2d->get_stream_playback();
+	} else if (player_3d) {
+		return player_3d->get_stream_playback();
+	}
+	return Ref<AudioStreamPlayback>();
+}
+
+} // namespace godot
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <godot_cpp/classes/audio_stream.hpp>
+#include <godot_cpp/classes/audio_stream_playback.hpp>
+#include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/variant/string_name.hpp>
+
+namespace godot {
+
+class AudioStreamPlayer;
+class AudioStreamPlayer2D;
+class AudioStreamPlayer3D;
+
+// The node a MidiPlayer pushes a generator stream into: an AudioStreamPlayer,
+// AudioStreamPlayer2D or AudioStreamPlayer3D. The three share no common base
+// class with these methods, so calls are dispatched on the concrete type.
+class MidiAudioOutput {
+public:
+	MidiAudioOutput() = default;
+	explicit MidiAudioOutput(Node *p_node);
+
+	bool is_valid() const { return node != nullptr; }
+	Node *get_node() const { return node; }
+
+	void set_stream(const Ref<AudioStream> &p_stream);
+	void set_bus(const StringName &p_bus);
+	void play();
+	void stop();
+	bool is_playing() const;
+	Ref<AudioStreamPlayback> get_stream_playback() const;
+
+private:
+	Node *node = nullptr;
+	AudioStreamPlayer *player = nullptr;
+	AudioStreamPlayer2D *player_2d = nullptr;
+	AudioStreamPlayer3D *player_3d = nullptr;
+};
+
+} // namespace godot
@@ -0,0 +1,168 @@
+#include "midi_dispatch.h"
+
+#include <climits>
+#include <cstring>
+
+#include "../lib/TinySoundFont/tml.h"
+#include "../lib/TinySoundFont/tsf.h"
+#include "midi_smf_stream.h"
+#include "tsf_ext.h"
+
+namespace godot {
+
+bool MidiEventDispatcher::is_channel_audible(int p_channel) const {
+	const uint16_t bit = (uint16_t)(1u << (p_channel & 0x0F));
+	return !(muted_channels & bit) && (solo_channels == 0 || (solo_channels & bit));
+}
+
+uint16_t MidiEventDispatcher::get_audible_mask() const {
+	uint16_t mask = 0;
+	for (int ch = 0; ch < 16; ch++) {
+		if (is_channel_audible(ch)) {
+			mask |= (uint16_t)(1u << ch);
+		}
+	}
+	return mask;
+}
+
+static int note_voice_count(const tsf *p_synth, int p_channel, int p_key, float p_vel) {
+	return tsfx_note_voice_count(p_synth, tsfx_channel_preset_index(p_synth, p_channel), p_key, p_vel);
+}
+
+bool MidiEventDispatcher::make_room_for_voice(tsf *p_synth, int p_channel, int p_voices) const {
+	if (p_voices <= 0) {
+		return true;
+	}
+	// A note with more layers than the cap allows would still overflow after stealing everything.
+	if (p_voices > voice_cap || (p_channel >= 0 && p_channel < 16 && channel_voice_limits[p_channel] > 0 && p_voices > channel_voice_limits[p_channel])) {
+		return false;
+	}
+	const int incoming_priority = (p_channel >= 0 && p_channel < 16) ? channel_priorities[p_channel] : INT_MAX;
+
+	// Per-channel cap: steal within the channel itself so one busy part can't starve the others.
+	if (p_channel >= 0 && p_channel < 16 && channel_voice_limits[p_channel] > 0) {
+		while (tsfx_voice_count(p_synth, p_channel) + p_voices > channel_voice_limits[p_channel]) {
+			const int voice = tsfx_pick_steal_voice(p_synth, steal_policy, p_channel, channel_priorities, incoming_priority);
+			if (voice < 0) {
+				return false;
+			}
+			tsfx_voice_kill(p_synth, voice);
+		}
+	}
+
+	while (tsfx_voice_count(p_synth, -1) + p_voices > voice_cap) {
+		const int voice = tsfx_pick_steal_voice(p_synth, steal_policy, -1, channel_priorities, incoming_priority);
+		if (voice < 0) {
+			// Only higher priority voices are playing: drop the new note instead.
+			return false;
+		}
+		tsfx_voice_kill(p_synth, voice);
+	}
+	return true;
+}
+
+void MidiEventDispatcher::apply_event(tsf *p_synth, const tml_message *p_msg, bool p_silent) {
+	if (!p_synth || !p_msg) {
+		return;
+	}
+
+	switch (p_msg->type) {
+		case TML_NOTE_ON: {
+			const float vel = (float)(uint8_t)p_msg->velocity / 127.0f;
+			held_velocity[p_msg->channel & 0x0F][p_msg->key & 0x7F] = (uint8_t)p_msg->velocity;
+			// Muted channels keep their state but never allocate voices.
+			if (p_silent || !is_channel_audible(p_msg->channel)) {
+				break;
+			}
+			if (vel > 0.0f && !make_room_for_voice(p_synth, p_msg->channel, note_voice_count(p_synth, p_msg->channel, p_msg->key, vel))) {
+				break;
+			}
+			tsf_channel_note_on(p_synth, p_msg->channel, p_msg->key, vel);
+		} break;
+		case TML_NOTE_OFF: {
+			held_velocity[p_msg->channel & 0x0F][p_msg->key & 0x7F] = 0;
+			tsf_channel_note_off(p_synth, p_msg->channel, p_msg->key);
+		} break;
+		case TML_CONTROL_CHANGE: {
+			const int control = (int)(uint8_t)p_msg->control;
+			if (control == TML_ALL_NOTES_OFF || control == TML_ALL_SOUND_OFF) {
+				memset(held_velocity[p_msg->channel & 0x0F], 0, sizeof(held_velocity[0]));
+			}
+			if (control == TML_EFFECTS1_DEPTH) {
+				reverb_sends[p_msg->channel & 0x0F] = (uint8_t)p_msg->control_value;
+			} else if (control == TML_EFFECTS3_DEPTH) {
+				chorus_sends[p_msg->channel & 0x0F] = (uint8_t)p_msg->control_value;
+			}
+			tsf_channel_midi_control(p_synth, p_msg->channel, control, (int)(uint8_t)p_msg->control_value);
+		} break;
+		case TML_PROGRAM_CHANGE: {
+			tsf_channel_set_presetnumber(p_synth, p_msg->channel, (int)(uint8_t)p_msg->program, p_msg->channel == 9);
+		} break;
+		case TML_PITCH_BEND: {
+			tsf_channel_set_pitchwheel(p_synth, p_msg->channel, (int)p_msg->pitch_bend);
+		} break;
+		case TML_CHANNEL_PRESSURE:
+		case TML_KEY_PRESSURE:
+			// Not directly supported by TSF channel API.
+			break;
+		default:
+			// Includes tempo meta messages and EOT. Times are already baked into Msg->time.
+			break;
+	}
+}
+
+const tml_message *MidiEventDispatcher::process_until(tsf *p_synth, const tml_message *p_cursor, uint32_t p_time_ms, bool p_silent) {
+	while (p_cursor && p_cursor->time <= p_time_ms) {
+		apply_event(p_synth, p_cursor, p_silent);
+		p_cursor = p_cursor->next;
+		events_dispatched++;
+	}
+	return p_cursor;
+}
+
+void MidiEventDispatcher::process_until(tsf *p_synth, MidiSmfStream &p_stream, uint32_t p_time_ms, bool p_silent) {
+	while (const tml_message *msg = p_stream.peek(p_time_ms)) {
+		apply_event(p_synth, msg, p_silent);
+		p_stream.pop();
+		events_dispatched++;
+	}
+}
+
+const tml_message *MidiEventDispatcher::process_after(tsf *p_synth, const tml_message *p_first, const tml_message *p_last, uint32_t p_time_ms, bool p_silent) {
+	const tml_message *next = p_last ? p_last->next : p_first;
+	while (next && next->time <= p_time_ms) {
+		apply_event(p_synth, next, p_silent);
+		p_last = next;
+		next = next->next;
+		events_dispatched++;
+	}
+	return p_last;
+}
+
+void MidiEventDispatcher::retrigger_held_notes(tsf *p_synth, uint16_t p_channel_mask) {
+	if (!p_synth) {
+		return;
+	}
+	for (int ch = 0; ch < 16; ch++) {
+		if (!(p_channel_mask & (1u << ch)) || !is_channel_audible(ch)) {
+			continue;
+		}
+		for (int key = 0; key < 128; key++) {
+			const uint8_t vel = held_velocity[ch][key];
+			if (vel && make_room_for_voice(p_synth, ch, note_voice_count(p_synth, ch, key, (float)vel / 127.0f))) {
+				tsf_channel_note_on(p_synth, ch, key, (float)vel / 127.0f);
+			}
+		}
+	}
+}
+
+void MidiEventDispatcher::clear_held_notes() {
+	memset(held_velocity, 0, sizeof(held_velocity));
+}
+
+void MidiEventDispatcher::reset_effect_sends() {
+	memset(reverb_sends, 40, sizeof(reverb_sends));
+	memset(chorus_sends, 0, sizeof(chorus_sends));
+}
+
+} // namespace godot
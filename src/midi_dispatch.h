@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+struct tsf;
+struct tml_message;
+
+namespace godot {
+
+class MidiSmfStream;
+
+// Applies TinyMidiLoader messages to a TinySoundFont synth: voice caps and
+// stealing, per-channel polyphony limits and channel mute/solo. Independent of
+// Godot so the native tools dispatch exactly like MidiPlayer does.
+class MidiEventDispatcher {
+public:
+	int steal_policy = 0; // TsfxStealPolicy
+	int voice_cap = 256;
+	int channel_voice_limits[16] = {}; // 0 = unlimited
+	int channel_priorities[16] = {};
+	uint16_t muted_channels = 0;
+	uint16_t solo_channels = 0;
+	// CC91 (reverb) and CC93 (chorus) send levels per channel, GM defaults until set.
+	uint8_t reverb_sends[16];
+	uint8_t chorus_sends[16];
+	// Velocity of notes currently held by the sequence, per channel/key (0 = off).
+	uint8_t held_velocity[16][128] = {};
+	// Running count of events passed through process_until().
+	uint64_t events_dispatched = 0;
+
+	MidiEventDispatcher() { reset_effect_sends(); }
+
+	bool is_channel_audible(int p_channel) const;
+	uint16_t get_audible_mask() const;
+
+	// Frees voices until a note on p_channel (negative: no channel) that starts
+	// p_voices voices (one per matching region of a layered preset) fits under the
+	// channel limit and voice_cap. Returns false if the note should be dropped.
+	bool make_room_for_voice(tsf *p_synth, int p_channel, int p_voices = 1) const;
+
+	// p_silent applies channel state but starts no notes.
+	void apply_event(tsf *p_synth, const tml_message *p_msg, bool p_silent);
+	// Applies every event at or before p_time_ms and returns the new cursor.
+	const tml_message *process_until(tsf *p_synth, const tml_message *p_cursor, uint32_t p_time_ms, bool p_silent);
+	// Same for a streamed file; consumes the messages from p_stream.
+	void process_until(tsf *p_synth, MidiSmfStream &p_stream, uint32_t p_time_ms, bool p_silent);
+	// Same for a list that grows while it plays (MidiEventList): p_last is the last
+	// message already applied (nullptr: none yet). Returns the new last message.
+	const tml_message *process_after(tsf *p_synth, const tml_message *p_first, const tml_message *p_last, uint32_t p_time_ms, bool p_silent);
+
+	// Restarts notes the sequence still holds on the given channels.
+	void retrigger_held_notes(tsf *p_synth, uint16_t p_channel_mask);
+	void clear_held_notes();
+	void reset_effect_sends();
+};
+
+} // namespace godot
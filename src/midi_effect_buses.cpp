@@ -0,0 +1,276 @@
+#include "midi_effect_buses.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <godot_cpp/classes/audio_stream_generator.hpp>
+#include <godot_cpp/classes/audio_stream_generator_playback.hpp>
+#include <godot_cpp/classes/audio_stream_player.hpp>
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/scene_tree.hpp>
+#include <godot_cpp/classes/window.hpp>
+#include <godot_cpp/core/object.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
+
+#include "midi_fast_math.h"
+#include "midi_send_effects.h"
+
+namespace godot {
+
+// Power of two so ring positions wrap with a mask; holds a bit over a second of sends.
+static constexpr int k_ring_frames = 1 << 16;
+static constexpr int k_fx_block_frames = 64;
+static constexpr float k_return_buffer_sec = 1.0f;
+// A bus with no senders keeps running this long so its reverb tail plays out.
+static constexpr double k_tail_sec = 8.0;
+
+namespace {
+
+struct EffectSettings {
+	StringName bus;
+	float room_size = 0.5f;
+	float damping = 0.5f;
+	float reverb_level = 1.0f;
+	float depth_ms = 4.0f;
+	float rate_hz = 0.8f;
+	float chorus_level = 1.0f;
+};
+
+struct EffectBus {
+	StringName name;
+	int senders = 0;
+	EffectSettings settings;
+	MidiReverb reverb;
+	MidiChorus chorus;
+	// Stereo interleaved send accumulators indexed by absolute frame & (k_ring_frames - 1).
+	std::vector<float> reverb_ring;
+	std::vector<float> chorus_ring;
+	int64_t read_pos = 0; // frames already processed
+	int64_t write_end = 0; // furthest frame any sender has written
+	int sample_rate = 44100;
+	int64_t tail_frames = 0; // frames processed since the last sender left
+	std::vector<float> wet;
+	PackedVector2Array push;
+	ObjectID output_id;
+	Ref<AudioStreamGenerator> generator;
+	Ref<AudioStreamPlayback> playback_base;
+	AudioStreamGeneratorPlayback *playback = nullptr; // borrowed from playback_base
+};
+
+std::vector<std::unique_ptr<EffectBus>> buses; // indexed by slot; null when free
+std::vector<EffectSettings> bus_settings;
+bool connected = false;
+
+SceneTree *get_scene_tree() {
+	return Object::cast_to<SceneTree>(Engine::get_singleton()->get_main_loop());
+}
+
+EffectSettings &settings_for(const StringName &p_bus) {
+	for (EffectSettings &settings : bus_settings) {
+		if (settings.bus == p_bus) {
+			return settings;
+		}
+	}
+	bus_settings.push_back(EffectSettings());
+	bus_settings.back().bus = p_bus;
+	return bus_settings.back();
+}
+
+void apply_settings(EffectBus &r_bus) {
+	r_bus.settings = settings_for(r_bus.name);
+	r_bus.reverb.set_room_size(r_bus.settings.room_size);
+	r_bus.reverb.set_damping(r_bus.settings.damping);
+	r_bus.chorus.set_depth_ms(r_bus.settings.depth_ms);
+	r_bus.chorus.set_rate_hz(r_bus.settings.rate_hz);
+}
+
+void destroy_bus(int p_slot) {
+	EffectBus *bus = buses[p_slot].get();
+	if (Object *node = ObjectDB::get_instance(bus->output_id)) {
+		Object::cast_to<Node>(node)->queue_free();
+	}
+	buses[p_slot].reset();
+}
+
+} // namespace
+
+int MidiEffectBuses::join(const StringName &p_bus, int p_sample_rate, int64_t &r_cursor) {
+	int free_slot = -1;
+	for (int i = 0; i < (int)buses.size(); i++) {
+		if (!buses[i]) {
+			free_slot = free_slot < 0 ? i : free_slot;
+		} else if (buses[i]->name == p_bus) {
+			buses[i]->senders++;
+			buses[i]->tail_frames = 0;
+			r_cursor = buses[i]->write_end;
+			return i;
+		}
+	}
+	if (free_slot < 0) {
+		free_slot = (int)buses.size();
+		buses.emplace_back();
+	}
+
+	buses[free_slot].reset(new EffectBus());
+	EffectBus &bus = *buses[free_slot];
+	bus.name = p_bus;
+	bus.senders = 1;
+	bus.sample_rate = p_sample_rate;
+	bus.reverb.configure(p_sample_rate);
+	bus.chorus.configure(p_sample_rate);
+	apply_settings(bus);
+	bus.reverb_ring.assign((size_t)k_ring_frames * 2, 0.0f);
+	bus.chorus_ring.assign((size_t)k_ring_frames * 2, 0.0f);
+	bus.wet.assign((size_t)k_fx_block_frames * 2, 0.0f);
+	bus.push.resize(k_fx_block_frames);
+	r_cursor = 0;
+
+	SceneTree *tree = get_scene_tree();
+	if (tree) {
+		AudioStreamPlayer *node = memnew(AudioStreamPlayer);
+		node->set_name(String("_MidiEffectReturn_") + String(p_bus));
+		bus.generator.instantiate();
+		bus.generator->set_mix_rate(p_sample_rate);
+		bus.generator->set_buffer_length(k_return_buffer_sec);
+		node->set_stream(bus.generator);
+		node->set_bus(p_bus);
+		// Deferred: joining happens from a player's _process, mid tree traversal.
+		tree->get_root()->call_deferred("add_child", node);
+		bus.output_id = node->get_instance_id();
+		if (!connected) {
+			tree->connect("process_frame", callable_mp_static(&MidiEffectBuses::_process_buses));
+			connected = true;
+		}
+	}
+	return free_slot;
+}
+
+void MidiEffectBuses::leave(int p_slot) {
+	if (p_slot < 0 || p_slot >= (int)buses.size() || !buses[p_slot]) {
+		return;
+	}
+	// With no senders left the bus lingers until its tail has played (see _process_buses()).
+	buses[p_slot]->senders = std::max(0, buses[p_slot]->senders - 1);
+}
+
+void MidiEffectBuses::add_sends(int p_slot, int64_t &r_cursor, const float *p_reverb, const float *p_chorus, int p_frames) {
+	if (p_slot < 0 || p_slot >= (int)buses.size() || !buses[p_slot]) {
+		return;
+	}
+	EffectBus &bus = *buses[p_slot];
+	// A sender behind the bus (it stalled, or joined late) continues from the bus position.
+	r_cursor = std::max(r_cursor, bus.read_pos);
+	if (r_cursor + p_frames <= bus.read_pos + k_ring_frames) {
+		float *reverb = bus.reverb_ring.data();
+		float *chorus = bus.chorus_ring.data();
+		for (int i = 0; i < p_frames; i++) {
+			const size_t at = (size_t)((r_cursor + i) & (k_ring_frames - 1)) * 2;
+			reverb[at] += p_reverb[i * 2];
+			reverb[at + 1] += p_reverb[i * 2 + 1];
+			chorus[at] += p_chorus[i * 2];
+			chorus[at + 1] += p_chorus[i * 2 + 1];
+		}
+	}
+	r_cursor += p_frames;
+	bus.write_end = std::max(bus.write_end, r_cursor);
+}
+
+void MidiEffectBuses::set_reverb(const StringName &p_bus, float p_room_size, float p_damping, float p_level) {
+	EffectSettings &settings = settings_for(p_bus);
+	settings.room_size = p_room_size;
+	settings.damping = p_damping;
+	settings.reverb_level = std::max(0.0f, p_level);
+	for (std::unique_ptr<EffectBus> &bus : buses) {
+		if (bus && bus->name == p_bus) {
+			apply_settings(*bus);
+		}
+	}
+}
+
+void MidiEffectBuses::set_chorus(const StringName &p_bus, float p_depth_ms, float p_rate_hz, float p_level) {
+	EffectSettings &settings = settings_for(p_bus);
+	settings.depth_ms = p_depth_ms;
+	settings.rate_hz = p_rate_hz;
+	settings.chorus_level = std::max(0.0f, p_level);
+	for (std::unique_ptr<EffectBus> &bus : buses) {
+		if (bus && bus->name == p_bus) {
+			apply_settings(*bus);
+		}
+	}
+}
+
+void MidiEffectBuses::shutdown() {
+	for (int i = 0; i < (int)buses.size(); i++) {
+		if (buses[i]) {
+			destroy_bus(i);
+		}
+	}
+	buses.clear();
+	bus_settings.clear();
+	SceneTree *tree = get_scene_tree();
+	if (connected && tree) {
+		tree->disconnect("process_frame", callable_mp_static(&MidiEffectBuses::_process_buses));
+	}
+	connected = false;
+}
+
+void MidiEffectBuses::_process_buses() {
+	// The reverb and chorus tails decay into denormals.
+	MidiDenormalScope denormals;
+	// Runs at the start of each frame, after every player pushed last frame's sends.
+	for (int slot = 0; slot < (int)buses.size(); slot++) {
+		if (!buses[slot]) {
+			continue;
+		}
+		EffectBus &bus = *buses[slot];
+		if (!bus.playback) {
+			AudioStreamPlayer *node = Object::cast_to<AudioStreamPlayer>(ObjectDB::get_instance(bus.output_id));
+			if (node && node->is_inside_tree()) {
+				node->play();
+				bus.playback_base = node->get_stream_playback();
+				bus.playback = Object::cast_to<AudioStreamGeneratorPlayback>(bus.playback_base.ptr());
+			}
+		}
+
+		const int64_t room = bus.playback ? (int64_t)bus.playback->get_frames_available() : INT64_MAX;
+		if (bus.senders == 0) {
+			if (bus.tail_frames >= (int64_t)(k_tail_sec * bus.sample_rate) || !bus.playback) {
+				destroy_bus(slot);
+				continue;
+			}
+			// Feed silence so the effects ring out.
+			bus.write_end = std::max(bus.write_end, bus.read_pos + std::min(room, (int64_t)k_ring_frames));
+		}
+		const int64_t pending = bus.write_end - bus.read_pos;
+		int64_t frames = std::min(pending, room);
+		frames -= frames % k_fx_block_frames;
+		for (; frames > 0; frames -= k_fx_block_frames) {
+			// read_pos stays a multiple of the block size, so a block never wraps.
+			const size_t at = (size_t)(bus.read_pos & (k_ring_frames - 1)) * 2;
+			float *reverb_in = bus.reverb_ring.data() + at;
+			float *chorus_in = bus.chorus_ring.data() + at;
+			if (bus.playback) {
+				std::fill(bus.wet.begin(), bus.wet.end(), 0.0f);
+				bus.reverb.process(reverb_in, bus.wet.data(), k_fx_block_frames, bus.settings.reverb_level);
+				bus.chorus.process(chorus_in, bus.wet.data(), k_fx_block_frames, bus.settings.chorus_level);
+				Vector2 *out = bus.push.ptrw();
+				for (int i = 0; i < k_fx_block_frames; i++) {
+					out[i] = Vector2(bus.wet[i * 2], bus.wet[i * 2 + 1]);
+				}
+				bus.playback->push_buffer(bus.push);
+			}
+			std::fill(reverb_in, reverb_in + k_fx_block_frames * 2, 0.0f);
+			std::fill(chorus_in, chorus_in + k_fx_block_frames * 2, 0.0f);
+			bus.read_pos += k_fx_block_frames;
+			if (bus.senders == 0) {
+				bus.tail_frames += k_fx_block_frames;
+			}
+		}
+	}
+}
+
+} // namespace godot
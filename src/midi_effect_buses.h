@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include <godot_cpp/variant/string_name.hpp>
+
+namespace godot {
+
+// One shared reverb and chorus per audio bus, fed by the CC91/CC93 sends of
+// every MidiPlayer outputting to that bus. Players add their send signal into
+// the bus's ring while rendering. Once per frame (SceneTree::process_frame)
+// each bus runs its effects over what was sent and pushes the wet signal
+// through its own return generator on that bus. Effect cost scales with the
+// number of buses, not the number of players or channels.
+//
+// Everything runs on the main thread.
+class MidiEffectBuses {
+public:
+	// Registers a sender on p_bus, creating the bus on first use (allocates; call
+	// outside the render scope). r_cursor is the sender's write position.
+	static int join(const StringName &p_bus, int p_sample_rate, int64_t &r_cursor);
+	static void leave(int p_slot);
+	// Adds p_frames of stereo interleaved send signal at r_cursor and advances it.
+	// Allocation-free. Sends that arrive too late or too far ahead are dropped.
+	static void add_sends(int p_slot, int64_t &r_cursor, const float *p_reverb, const float *p_chorus, int p_frames);
+
+	static void set_reverb(const StringName &p_bus, float p_room_size, float p_damping, float p_level);
+	static void set_chorus(const StringName &p_bus, float p_depth_ms, float p_rate_hz, float p_level);
+
+	// Called when the extension unloads.
+	static void shutdown();
+
+private:
+	static void _process_buses();
+};
+
+} // namespace godot
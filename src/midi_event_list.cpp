@@ -0,0 +1,49 @@
+#include "midi_event_list.h"
+
+#include <algorithm>
+
+namespace godot {
+
+tml_message *MidiEventList::_allocate() {
+	if (chunk_used == k_chunk_messages) {
+		chunks.emplace_back(new tml_message[k_chunk_messages]);
+		chunk_used = 0;
+	}
+	return &chunks.back()[chunk_used++];
+}
+
+void MidiEventList::insert(const tml_message *p_messages, int p_count) {
+	if (!p_messages || p_count <= 0) {
+		return;
+	}
+	const auto by_time = [](const tml_message *p_a, const tml_message *p_b) { return p_a->time < p_b->time; };
+	const size_t old_size = order.size();
+	order.reserve(old_size + (size_t)p_count);
+	for (int i = 0; i < p_count; i++) {
+		tml_message *msg = _allocate();
+		*msg = p_messages[i];
+		msg->next = nullptr;
+		order.push_back(msg);
+	}
+	std::stable_sort(order.begin() + old_size, order.end(), by_time);
+
+	// Usually the batch lands after everything already there and nothing moves.
+	const auto first_moved = std::upper_bound(order.begin(), order.begin() + old_size, order[old_size], by_time);
+	std::inplace_merge(first_moved, order.begin() + old_size, order.end(), by_time);
+
+	size_t relink = (size_t)(first_moved - order.begin());
+	relink = relink > 0 ? relink - 1 : 0;
+	for (size_t i = relink; i + 1 < order.size(); i++) {
+		order[i]->next = order[i + 1];
+	}
+	order.back()->next = nullptr;
+}
+
+void MidiEventList::clear() {
+	chunks.clear();
+	chunk_used = k_chunk_messages;
+	order.clear();
+	generation++;
+}
+
+} // namespace godot
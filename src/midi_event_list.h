@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../lib/TinySoundFont/tml.h"
+
+namespace godot {
+
+// Time-ordered tml_message list that can grow while it is being played. Messages
+// live in fixed-size chunks and never move, so players can follow next pointers
+// across inserts; only clear() frees them. A player should remember the last
+// message it dispatched rather than the next one: messages inserted after that
+// point are then picked up even if they land before its old successor.
+class MidiEventList {
+public:
+	static constexpr int k_chunk_messages = 1024;
+
+	// Inserts p_count messages in any order. Each goes after every existing message
+	// with the same or an earlier time; next pointers are set by the list.
+	void insert(const tml_message *p_messages, int p_count);
+	void clear();
+
+	const tml_message *first() const { return order.empty() ? nullptr : order.front(); }
+	int size() const { return (int)order.size(); }
+	uint32_t get_end_ms() const { return order.empty() ? 0 : order.back()->time; }
+	// Changes on clear(), so players can tell their last message was freed.
+	uint32_t get_generation() const { return generation; }
+
+private:
+	tml_message *_allocate();
+
+	std::vector<std::unique_ptr<tml_message[]>> chunks;
+	int chunk_used = k_chunk_messages;
+	std::vector<tml_message *> order; // every message by time, for finding insertion points
+	uint32_t generation = 0;
+};
+
+} // namespace godot
@@ -0,0 +1,118 @@
+#pragma once
+
+// Approximations for the math TinySoundFont runs at every control update
+// (pitch ratio, envelope and dB-to-gain), wired in through its TSF_POWF-style
+// macros in thirdparty_tsf_tml.cpp. Relative error stays within about 1.1e-6
+// over the ranges the synth uses (under 0.002 cents of pitch, 1e-5 dB of gain).
+// Define MIDI_EXACT_MATH (scons fast_math=no) to use libm instead.
+//
+// MidiDenormalScope sets flush-to-zero / denormals-are-zero for the current
+// thread while it lives, so decaying release tails and filter states do not
+// fall into slow denormal arithmetic.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MIDI_DENORMAL_SSE
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+#define MIDI_DENORMAL_AARCH64
+#endif
+
+namespace godot {
+
+// 2^x. Rounds to the nearest integer exponent and evaluates the Taylor series of
+// 2^f for |f| <= 0.5 through degree 6 (truncation error < 1.3e-7).
+inline float midi_fast_exp2f(float p_x) {
+	if (!(p_x > -126.0f)) {
+		return p_x != p_x ? p_x : 0.0f;
+	}
+	if (p_x >= 128.0f) {
+		return HUGE_VALF;
+	}
+	const float n = std::floor(p_x + 0.5f);
+	const float f = p_x - n;
+	const float p = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f + f * (0.00961812911f + f * (0.00133335581f + f * 0.000154035304f)))));
+	const int32_t exponent_bits = ((int32_t)n + 127) << 23;
+	float scale;
+	memcpy(&scale, &exponent_bits, sizeof(scale));
+	return p * scale;
+}
+
+// log2(x) for normal positive x: exponent plus 2*atanh((m-1)/(m+1)) for the
+// mantissa m in [sqrt(1/2), sqrt(2)), series through s^9 (error < 3e-9).
+inline float midi_fast_log2f(float p_x) {
+	uint32_t bits;
+	memcpy(&bits, &p_x, sizeof(bits));
+	const uint32_t biased = bits >> 23;
+	if (biased == 0 || biased >= 255) {
+		// Zero, negative, denormal, inf or NaN.
+		return std::log2(p_x);
+	}
+	int exponent = (int)biased - 127;
+	bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+	float m;
+	memcpy(&m, &bits, sizeof(m));
+	if (m > 1.41421356f) {
+		m *= 0.5f;
+		exponent++;
+	}
+	const float s = (m - 1.0f) / (m + 1.0f);
+	const float s2 = s * s;
+	const float ln = 2.0f * s * (1.0f + s2 * (1.0f / 3.0f + s2 * (1.0f / 5.0f + s2 * (1.0f / 7.0f + s2 * (1.0f / 9.0f)))));
+	return (float)exponent + ln * 1.44269504f;
+}
+
+inline float midi_fast_powf(float p_base, float p_exponent) {
+	if (p_base == 2.0f) {
+		return midi_fast_exp2f(p_exponent);
+	}
+	if (!(p_base > 0.0f)) {
+		return std::pow(p_base, p_exponent);
+	}
+	return midi_fast_exp2f(p_exponent * midi_fast_log2f(p_base));
+}
+
+inline double midi_fast_pow(double p_base, double p_exponent) {
+	return (double)midi_fast_powf((float)p_base, (float)p_exponent);
+}
+
+inline float midi_fast_expf(float p_x) {
+	return midi_fast_exp2f(p_x * 1.44269504f);
+}
+
+inline float midi_fast_log10f(float p_x) {
+	return midi_fast_log2f(p_x) * 0.301029996f;
+}
+
+class MidiDenormalScope {
+public:
+	MidiDenormalScope() {
+#if defined(MIDI_DENORMAL_SSE)
+		saved = _mm_getcsr();
+		_mm_setcsr(saved | 0x8040); // FTZ | DAZ
+#elif defined(MIDI_DENORMAL_AARCH64)
+		uint64_t fpcr;
+		__asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+		saved = fpcr;
+		__asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (1ull << 24))); // FZ
+#endif
+	}
+	~MidiDenormalScope() {
+#if defined(MIDI_DENORMAL_SSE)
+		_mm_setcsr((unsigned int)saved);
+#elif defined(MIDI_DENORMAL_AARCH64)
+		__asm__ __volatile__("msr fpcr, %0" : : "r"(saved));
+#endif
+	}
+
+	MidiDenormalScope(const MidiDenormalScope &) = delete;
+	MidiDenormalScope &operator=(const MidiDenormalScope &) = delete;
+
+private:
+	uint64_t saved = 0;
+};
+
+} // namespace godot
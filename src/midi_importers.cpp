@@ -5,7 +5,11 @@
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
+#include <cstring>
+#include <vector>
+
 #include "midi_resources.h"
+#include "midi_smf_optimizer.h"
 
 namespace godot {
 
@@ -51,8 +55,30 @@ String MidiImporter::_get_preset_name(int p_preset_index) const {
 	return "Default";
 }
 
+static Dictionary make_import_option(const String &p_name, const Variant &p_default, PropertyHint p_hint = PROPERTY_HINT_NONE, const String &p_hint_string = String()) {
+	Dictionary option;
+	option["name"] = p_name;
+	option["default_value"] = p_default;
+	option["property_hint"] = p_hint;
+	option["hint_string"] = p_hint_string;
+	return option;
+}
+
 TypedArray<Dictionary> MidiImporter::_get_import_options(const String &p_path, int32_t p_preset_index) const {
-	return TypedArray<Dictionary>();
+	const MidiOptimizeOptions defaults;
+	TypedArray<Dictionary> options;
+	options.push_back(make_import_option("optimize/enabled", false));
+	options.push_back(make_import_option("optimize/controller_tolerance", defaults.controller_tolerance, PROPERTY_HINT_RANGE, "0,16,1"));
+	options.push_back(make_import_option("optimize/pitch_bend_tolerance", defaults.pitch_bend_tolerance, PROPERTY_HINT_RANGE, "0,512,1"));
+	options.push_back(make_import_option("optimize/min_interval_ms", defaults.min_interval_ms, PROPERTY_HINT_RANGE, "0,50,0.5,suffix:ms"));
+	return options;
+}
+
+bool MidiImporter::_get_option_visibility(const String &p_path, const StringName &p_option_name, const Dictionary &p_options) const {
+	if (p_option_name != StringName("optimize/enabled") && String(p_option_name).begins_with("optimize/")) {
+		return (bool)p_options.get("optimize/enabled", false);
+	}
+	return true;
 }
 
 Error MidiImporter::_import(const String &p_source_file, const String &p_save_path, const Dictionary &p_options,
@@ -63,6 +89,27 @@ Error MidiImporter::_import(const String &p_source_file, const String &p_save_pa
 		return ERR_CANT_OPEN;
 	}
 
+	if ((bool)p_options.get("optimize/enabled", false)) {
+		// Redundant and over-dense events are removed once here instead of dispatched every playback.
+		MidiOptimizeOptions options;
+		options.controller_tolerance = (int)p_options.get("optimize/controller_tolerance", options.controller_tolerance);
+		options.pitch_bend_tolerance = (int)p_options.get("optimize/pitch_bend_tolerance", options.pitch_bend_tolerance);
+		options.min_interval_ms = (double)p_options.get("optimize/min_interval_ms", options.min_interval_ms);
+		std::vector<uint8_t> optimized;
+		MidiOptimizeStats stats;
+		if (midi_optimize_smf(bytes.ptr(), (size_t)bytes.size(), options, optimized, stats)) {
+			bytes.resize((int64_t)optimized.size());
+			memcpy(bytes.ptrw(), optimized.data(), optimized.size());
+			const int64_t removed = stats.events_before - stats.events_after;
+			UtilityFunctions::print(String("MidiPlayer importer: ") + p_source_file + ": removed " + String::num_int64(removed) +
+					" of " + String::num_int64(stats.events_before) + " events (" +
+					String::num(stats.events_before > 0 ? 100.0 * (double)removed / (double)stats.events_before : 0.0, 1) + "%), " +
+					String::num_int64(stats.bytes_before) + " -> " + String::num_int64(stats.bytes_after) + " bytes.");
+		} else {
+			UtilityFunctions::push_warning("MidiPlayer importer: not a Standard MIDI File, imported unoptimized: " + p_source_file);
+		}
+	}
+
 	Ref<MidiFileResource> res = memnew(MidiFileResource);
 	res->set_data(bytes);
 
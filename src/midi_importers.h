@@ -22,6 +22,7 @@ public:
 	int _get_preset_count() const override;
 	String _get_preset_name(int p_preset_index) const override;
 	TypedArray<Dictionary> _get_import_options(const String &p_path, int32_t p_preset_index) const override;
+	bool _get_option_visibility(const String &p_path, const StringName &p_option_name, const Dictionary &p_options) const override;
 	Error _import(const String &p_source_file, const String &p_save_path, const Dictionary &p_options,
 			const TypedArray<String> &p_platform_variants, const TypedArray<String> &p_gen_files) const override;
 
@@ -0,0 +1,62 @@
+#include "midi_loop_cache.h"
+
+#include <algorithm>
+
+namespace godot {
+
+void MidiLoopCache::begin_recording(int64_t p_max_frames, uint64_t p_key) {
+	const size_t wanted = (size_t)std::max<int64_t>(0, p_max_frames) * 2;
+	samples.clear();
+	// Passes of the same sequence reuse the previous allocation.
+	if (samples.capacity() != wanted) {
+		std::vector<float>().swap(samples);
+		samples.reserve(wanted);
+	}
+	max_samples = wanted;
+	state = wanted > 0 ? STATE_RECORDING : STATE_EMPTY;
+	key = p_key;
+	frames = 0;
+	read_pos = 0;
+}
+
+void MidiLoopCache::record(const float *p_interleaved, int p_frames) {
+	if (state != STATE_RECORDING) {
+		return;
+	}
+	const size_t count = (size_t)p_frames * 2;
+	if (samples.size() + count > max_samples) {
+		invalidate();
+		return;
+	}
+	samples.insert(samples.end(), p_interleaved, p_interleaved + count);
+	frames += p_frames;
+}
+
+void MidiLoopCache::finish_recording() {
+	if (state == STATE_RECORDING) {
+		state = frames > 0 ? STATE_READY : STATE_EMPTY;
+	}
+}
+
+void MidiLoopCache::invalidate() {
+	state = STATE_EMPTY;
+}
+
+void MidiLoopCache::release() {
+	std::vector<float>().swap(samples);
+	max_samples = 0;
+	state = STATE_EMPTY;
+	frames = 0;
+	read_pos = 0;
+}
+
+const float *MidiLoopCache::read(int p_frames) {
+	if (read_pos + p_frames > frames) {
+		return nullptr;
+	}
+	const float *out = samples.data() + (size_t)read_pos * 2;
+	read_pos += p_frames;
+	return out;
+}
+
+} // namespace godot
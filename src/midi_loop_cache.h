@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// PCM of one pass of a looping sequence, recorded from the main output on the
+// first pass and replayed on later passes instead of synthesizing again
+// (MidiPlayer.loop_cache_mb). The key identifies everything the recording
+// depends on; a recording only replays under the key it was made with.
+class MidiLoopCache {
+public:
+	enum State {
+		STATE_EMPTY,
+		STATE_RECORDING,
+		STATE_READY,
+	};
+
+	// Reserves room for p_max_frames stereo frames. Allocates here so that
+	// record() and read() never do.
+	void begin_recording(int64_t p_max_frames, uint64_t p_key);
+	// Appends a stereo interleaved block. A pass that does not fit is dropped.
+	void record(const float *p_interleaved, int p_frames);
+	void finish_recording();
+	// Forgets the recording but keeps its memory for the next one.
+	void invalidate();
+	void release();
+
+	State get_state() const { return state; }
+	uint64_t get_key() const { return key; }
+	int64_t get_memory_bytes() const { return (int64_t)(samples.capacity() * sizeof(float)); }
+	bool can_replay(uint64_t p_key) const { return state == STATE_READY && key == p_key; }
+
+	void rewind() { read_pos = 0; }
+	// Next p_frames recorded frames, or nullptr once the pass is used up.
+	const float *read(int p_frames);
+	bool is_at_end() const { return read_pos >= frames; }
+
+private:
+	State state = STATE_EMPTY;
+	uint64_t key = 0;
+	std::vector<float> samples; // interleaved stereo, never grown past the reservation
+	size_t max_samples = 0;
+	int64_t frames = 0;
+	int64_t read_pos = 0;
+};
+
+} // namespace godot
@@ -0,0 +1,75 @@
+#include "midi_note_index.h"
+
+#include <algorithm>
+
+#include "../lib/TinySoundFont/tml.h"
+
+namespace godot {
+
+void MidiNoteIndex::clear() {
+	notes.clear();
+	notes.shrink_to_fit();
+}
+
+void MidiNoteIndex::build(const tml_message *p_first) {
+	notes.clear();
+
+	// Open notes per channel/key, oldest first, so overlapping notes on the same
+	// key are closed in the order they were started.
+	std::vector<uint32_t> open[16][128];
+	uint32_t end_ms = 0;
+
+	for (const tml_message *msg = p_first; msg; msg = msg->next) {
+		end_ms = msg->time;
+		const int ch = msg->channel & 0x0F;
+		const int key = (uint8_t)msg->key & 0x7F;
+
+		const bool is_note_on = msg->type == TML_NOTE_ON && (uint8_t)msg->velocity > 0;
+		const bool is_note_off = msg->type == TML_NOTE_OFF || (msg->type == TML_NOTE_ON && (uint8_t)msg->velocity == 0);
+
+		if (is_note_on) {
+			MidiNoteSpan span;
+			span.time_ms = msg->time;
+			span.key = (uint8_t)key;
+			span.velocity = (uint8_t)msg->velocity;
+			span.channel = (uint8_t)ch;
+			open[ch][key].push_back((uint32_t)notes.size());
+			notes.push_back(span);
+		} else if (is_note_off) {
+			std::vector<uint32_t> &pending = open[ch][key];
+			if (!pending.empty()) {
+				MidiNoteSpan &span = notes[pending.front()];
+				span.duration_ms = msg->time - span.time_ms;
+				pending.erase(pending.begin());
+			}
+		}
+	}
+
+	// Notes never released last until the end of the song.
+	for (int ch = 0; ch < 16; ch++) {
+		for (int key = 0; key < 128; key++) {
+			for (uint32_t index : open[ch][key]) {
+				notes[index].duration_ms = end_ms - notes[index].time_ms;
+			}
+		}
+	}
+
+	// Messages arrive in time order already; keep the sort stable for safety.
+	std::stable_sort(notes.begin(), notes.end(), [](const MidiNoteSpan &a, const MidiNoteSpan &b) {
+		return a.time_ms < b.time_ms;
+	});
+	notes.shrink_to_fit();
+}
+
+void MidiNoteIndex::find_range(uint32_t p_from_ms, uint32_t p_to_ms, size_t &r_begin, size_t &r_end) const {
+	const auto first = std::lower_bound(notes.begin(), notes.end(), p_from_ms, [](const MidiNoteSpan &span, uint32_t t) {
+		return span.time_ms < t;
+	});
+	const auto last = std::lower_bound(first, notes.end(), p_to_ms, [](const MidiNoteSpan &span, uint32_t t) {
+		return span.time_ms < t;
+	});
+	r_begin = (size_t)(first - notes.begin());
+	r_end = (size_t)(last - notes.begin());
+}
+
+} // namespace godot
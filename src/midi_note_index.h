@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct tml_message;
+
+namespace godot {
+
+// A single note with its note-on/note-off already paired.
+struct MidiNoteSpan {
+	uint32_t time_ms = 0;
+	uint32_t duration_ms = 0;
+	uint8_t key = 0;
+	uint8_t velocity = 0;
+	uint8_t channel = 0;
+};
+
+// Time-sorted note index built once per loaded MIDI file so that range
+// queries are a binary search plus a walk over the matching notes.
+class MidiNoteIndex {
+public:
+	void build(const tml_message *p_first);
+	void clear();
+
+	bool is_empty() const { return notes.empty(); }
+	size_t size() const { return notes.size(); }
+	const MidiNoteSpan &operator[](size_t p_index) const { return notes[p_index]; }
+
+	// Index range [r_begin, r_end) of notes starting in [p_from_ms, p_to_ms).
+	void find_range(uint32_t p_from_ms, uint32_t p_to_ms, size_t &r_begin, size_t &r_end) const;
+
+private:
+	std::vector<MidiNoteSpan> notes;
+};
+
+} // namespace godot
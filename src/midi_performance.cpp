@@ -0,0 +1,122 @@
+#include "midi_performance.h"
+
+#include <algorithm>
+
+#include <godot_cpp/classes/performance.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+
+#include "midi_player.h"
+
+namespace godot {
+
+static LocalVector<MidiPlayer *> monitored_players;
+static bool monitors_added = false;
+
+static const char *k_monitor_render = "MidiPlayer/render_usec_per_block";
+static const char *k_monitor_voices = "MidiPlayer/active_voices";
+static const char *k_monitor_peak = "MidiPlayer/peak_voices";
+static const char *k_monitor_underruns = "MidiPlayer/underruns";
+static const char *k_monitor_pushed = "MidiPlayer/frames_pushed";
+static const char *k_monitor_backlog = "MidiPlayer/event_backlog";
+static const char *k_monitor_memory = "MidiPlayer/sample_memory";
+
+void MidiPerformanceMonitors::add_player(MidiPlayer *p_player) {
+	if (monitored_players.find(p_player) < 0) {
+		monitored_players.push_back(p_player);
+	}
+	if (monitors_added) {
+		return;
+	}
+	Performance *performance = Performance::get_singleton();
+	if (!performance) {
+		return;
+	}
+	// Monitors stay registered until the extension unloads so debugger graphs don't reset.
+	performance->add_custom_monitor(k_monitor_render, callable_mp_static(&MidiPerformanceMonitors::_render_usec_per_block));
+	performance->add_custom_monitor(k_monitor_voices, callable_mp_static(&MidiPerformanceMonitors::_active_voices));
+	performance->add_custom_monitor(k_monitor_peak, callable_mp_static(&MidiPerformanceMonitors::_peak_voices));
+	performance->add_custom_monitor(k_monitor_underruns, callable_mp_static(&MidiPerformanceMonitors::_underruns));
+	performance->add_custom_monitor(k_monitor_pushed, callable_mp_static(&MidiPerformanceMonitors::_frames_pushed));
+	performance->add_custom_monitor(k_monitor_backlog, callable_mp_static(&MidiPerformanceMonitors::_event_backlog));
+	performance->add_custom_monitor(k_monitor_memory, callable_mp_static(&MidiPerformanceMonitors::_sample_memory));
+	monitors_added = true;
+}
+
+void MidiPerformanceMonitors::remove_player(MidiPlayer *p_player) {
+	monitored_players.erase(p_player);
+}
+
+void MidiPerformanceMonitors::remove_monitors() {
+	monitored_players.clear();
+	Performance *performance = Performance::get_singleton();
+	if (!monitors_added || !performance) {
+		return;
+	}
+	for (const char *id : { k_monitor_render, k_monitor_voices, k_monitor_peak, k_monitor_underruns, k_monitor_pushed, k_monitor_backlog, k_monitor_memory }) {
+		if (performance->has_custom_monitor(id)) {
+			performance->remove_custom_monitor(id);
+		}
+	}
+	monitors_added = false;
+}
+
+// Render cost adds up across players since they all render on the main thread.
+double MidiPerformanceMonitors::_render_usec_per_block() {
+	double total = 0.0;
+	for (const MidiPlayer *player : monitored_players) {
+		total += player->perf_stats.render_usec_per_block;
+	}
+	return total;
+}
+
+double MidiPerformanceMonitors::_active_voices() {
+	int64_t total = 0;
+	for (const MidiPlayer *player : monitored_players) {
+		total += player->_get_active_voice_count();
+	}
+	return (double)total;
+}
+
+// Largest peak of any single player.
+double MidiPerformanceMonitors::_peak_voices() {
+	int peak = 0;
+	for (const MidiPlayer *player : monitored_players) {
+		peak = std::max(peak, player->perf_stats.peak_voices);
+	}
+	return (double)peak;
+}
+
+double MidiPerformanceMonitors::_underruns() {
+	int64_t total = 0;
+	for (const MidiPlayer *player : monitored_players) {
+		total += player->perf_stats.underruns;
+	}
+	return (double)total;
+}
+
+double MidiPerformanceMonitors::_frames_pushed() {
+	int64_t total = 0;
+	for (const MidiPlayer *player : monitored_players) {
+		total += player->perf_stats.frames_pushed;
+	}
+	return (double)total;
+}
+
+double MidiPerformanceMonitors::_event_backlog() {
+	int64_t total = 0;
+	for (const MidiPlayer *player : monitored_players) {
+		total += player->perf_stats.event_backlog;
+	}
+	return (double)total;
+}
+
+double MidiPerformanceMonitors::_sample_memory() {
+	int64_t total = 0;
+	for (const MidiPlayer *player : monitored_players) {
+		total += player->_get_sample_memory_bytes();
+	}
+	return (double)total;
+}
+
+} // namespace godot
@@ -0,0 +1,28 @@
+#pragma once
+
+namespace godot {
+
+class MidiPlayer;
+
+// Performance custom monitors ("MidiPlayer/..." in the debugger's Monitors tab)
+// aggregated over every MidiPlayer in the scene tree. Script telemetry can read
+// them with Performance.get_custom_monitor(), or per player through
+// MidiPlayer.get_performance_stats().
+class MidiPerformanceMonitors {
+public:
+	static void add_player(MidiPlayer *p_player);
+	static void remove_player(MidiPlayer *p_player);
+	// Called when the extension unloads.
+	static void remove_monitors();
+
+private:
+	static double _render_usec_per_block();
+	static double _active_voices();
+	static double _peak_voices();
+	static double _underruns();
+	static double _frames_pushed();
+	static double _event_backlog();
+	static double _sample_memory();
+};
+
+} // namespace godot
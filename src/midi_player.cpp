@@ -1,9 +1,15 @@
 #include "midi_player.h"
 
 #include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
 #include <vector>
 
 #include <godot_cpp/classes/audio_server.hpp>
+#include <godot_cpp/classes/audio_stream_playback_polyphonic.hpp>
+#include <godot_cpp/classes/audio_stream_polyphonic.hpp>
+#include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/time.hpp>
 #include <godot_cpp/core/class_db.hpp>
@@ -12,21 +18,62 @@
 
 #include "../lib/TinySoundFont/tsf.h"
 #include "../lib/TinySoundFont/tml.h"
+#include "midi_effect_buses.h"
+#include "midi_fast_math.h"
+#include "midi_performance.h"
+#include "midi_rt_audit.h"
+#include "midi_trace.h"
+#include "tsf_ext.h"
 
 namespace godot {
 
 static constexpr int k_block_frames = 64;
+static constexpr int k_max_outputs = 8;
+static constexpr int k_one_shot_polyphony = 32;
+// Release tails of pre-rendered notes are cut off after this long.
+static constexpr float k_max_one_shot_tail_sec = 10.0f;
+static constexpr int k_max_quality_level = 3;
+static constexpr int k_min_degraded_voices = 8;
+// Releasing voices quieter than this (about -26 dB) are culled at the highest degradation level.
+static constexpr float k_quiet_release_gain = 0.05f;
+// Adaptive quality: load must stay over budget this long before the level goes up,
+// and under half the budget this long before it comes back down.
+static constexpr double k_quality_busy_sec = 0.25;
+static constexpr double k_quality_calm_sec = 1.0;
+// Adaptive buffer: below this fraction of the target the buffer is about to run dry.
+static constexpr float k_buffer_low_water = 0.25f;
+static constexpr float k_buffer_grow_factor = 1.5f;
+static constexpr float k_buffer_shrink_factor = 0.9f;
+static constexpr double k_buffer_calm_sec = 1.0;
+// Released voices below this (about -90 dB) are cut when nothing else keeps the player awake.
+static constexpr float k_silent_tail_gain = 0.00003f;
+// Room reserved past the end of the sequence for release tails when recording a loop pass.
+static constexpr double k_loop_cache_tail_sec = 10.0;
+static constexpr float k_max_loop_cache_mb = 1024.0f;
 
 MidiPlayer::MidiPlayer() {
-	set_process(true);
+	upsampler.configure(synthesis_rate_divisor, k_block_frames);
+	notes_upsampler.configure(synthesis_rate_divisor, k_block_frames);
+	// Render scratch is allocated once so the pump never touches the heap.
+	render_blocks.resize((size_t)k_max_outputs * k_block_frames * 2);
+	channel_blocks.resize((size_t)17 * k_block_frames * 2);
+	send_blocks.resize((size_t)k_max_outputs * 2 * k_block_frames * 2);
+	send_upsampled.resize((size_t)2 * k_block_frames * 2);
+	upsample_block.resize((size_t)k_block_frames * 2);
+	push_block.resize(k_block_frames);
+	// Starts idle; play() and note_on() turn processing on.
+	set_process(false);
 }
 
 MidiPlayer::~MidiPlayer() {
+	MidiPerformanceMonitors::remove_player(this);
 	stop();
+	_leave_effect_buses();
 	if (midi) {
 		tml_free(midi);
 		midi = nullptr;
 	}
+	smf_stream.close();
 	if (sf) {
 		tsf_close(sf);
 		sf = nullptr;
@@ -46,6 +93,15 @@ void MidiPlayer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_midi"), &MidiPlayer::get_midi);
 	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::OBJECT, "midi", PROPERTY_HINT_RESOURCE_TYPE, "MidiFileResource"), "set_midi", "get_midi");
 
+	ClassDB::bind_method(D_METHOD("set_sequence", "sequence"), &MidiPlayer::set_sequence);
+	ClassDB::bind_method(D_METHOD("get_sequence"), &MidiPlayer::get_sequence);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::OBJECT, "sequence", PROPERTY_HINT_RESOURCE_TYPE, "MidiSequence"), "set_sequence", "get_sequence");
+
+	ClassDB::bind_method(D_METHOD("set_stream_threshold_kb", "kb"), &MidiPlayer::set_stream_threshold_kb);
+	ClassDB::bind_method(D_METHOD("get_stream_threshold_kb"), &MidiPlayer::get_stream_threshold_kb);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::INT, "stream_threshold_kb", PROPERTY_HINT_RANGE, "0,1048576,1,suffix:KiB"), "set_stream_threshold_kb", "get_stream_threshold_kb");
+	ClassDB::bind_method(D_METHOD("is_streaming"), &MidiPlayer::is_streaming);
+
 	ClassDB::bind_method(D_METHOD("set_loop", "loop"), &MidiPlayer::set_loop);
 	ClassDB::bind_method(D_METHOD("get_loop"), &MidiPlayer::get_loop);
 	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::BOOL, "loop"), "set_loop", "get_loop");
@@ -53,6 +109,11 @@ void MidiPlayer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_looping", "looping"), &MidiPlayer::set_looping);
 	ClassDB::bind_method(D_METHOD("is_looping"), &MidiPlayer::is_looping);
 
+	ClassDB::bind_method(D_METHOD("set_loop_cache_mb", "mb"), &MidiPlayer::set_loop_cache_mb);
+	ClassDB::bind_method(D_METHOD("get_loop_cache_mb"), &MidiPlayer::get_loop_cache_mb);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::FLOAT, "loop_cache_mb", PROPERTY_HINT_RANGE, "0,1024,1,suffix:MiB"), "set_loop_cache_mb", "get_loop_cache_mb");
+	ClassDB::bind_method(D_METHOD("is_loop_cache_replaying"), &MidiPlayer::is_loop_cache_replaying);
+
 	ClassDB::bind_method(D_METHOD("set_midi_speed", "speed"), &MidiPlayer::set_midi_speed);
 	ClassDB::bind_method(D_METHOD("get_midi_speed"), &MidiPlayer::get_midi_speed);
 	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::FLOAT, "midi_speed", PROPERTY_HINT_RANGE, "0.1,4.0,0.01"), "set_midi_speed", "get_midi_speed");
@@ -65,10 +126,82 @@ void MidiPlayer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_generator_buffer_length"), &MidiPlayer::get_generator_buffer_length);
 	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::FLOAT, "generator_buffer_length", PROPERTY_HINT_RANGE, "0.05,2.0,0.01"), "set_generator_buffer_length", "get_generator_buffer_length");
 
+	ClassDB::bind_method(D_METHOD("set_adaptive_buffer", "enable"), &MidiPlayer::set_adaptive_buffer);
+	ClassDB::bind_method(D_METHOD("get_adaptive_buffer"), &MidiPlayer::get_adaptive_buffer);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::BOOL, "adaptive_buffer"), "set_adaptive_buffer", "get_adaptive_buffer");
+
+	ClassDB::bind_method(D_METHOD("set_min_buffer_length", "seconds"), &MidiPlayer::set_min_buffer_length);
+	ClassDB::bind_method(D_METHOD("get_min_buffer_length"), &MidiPlayer::get_min_buffer_length);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::FLOAT, "min_buffer_length", PROPERTY_HINT_RANGE, "0.01,2.0,0.01"), "set_min_buffer_length", "get_min_buffer_length");
+
+	ClassDB::bind_method(D_METHOD("get_buffer_target_length"), &MidiPlayer::get_buffer_target_length);
+
+	ClassDB::bind_method(D_METHOD("set_max_voices", "max_voices"), &MidiPlayer::set_max_voices);
+	ClassDB::bind_method(D_METHOD("get_max_voices"), &MidiPlayer::get_max_voices);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::INT, "max_voices", PROPERTY_HINT_RANGE, "1,1024,1"), "set_max_voices", "get_max_voices");
+
+	ClassDB::bind_method(D_METHOD("set_voice_steal_policy", "policy"), &MidiPlayer::set_voice_steal_policy);
+	ClassDB::bind_method(D_METHOD("get_voice_steal_policy"), &MidiPlayer::get_voice_steal_policy);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::INT, "voice_steal_policy", PROPERTY_HINT_ENUM, "Oldest,Quietest,Lowest Priority Channel,Released First"), "set_voice_steal_policy", "get_voice_steal_policy");
+
+	ClassDB::bind_method(D_METHOD("set_channel_voice_limit", "channel", "limit"), &MidiPlayer::set_channel_voice_limit);
+	ClassDB::bind_method(D_METHOD("get_channel_voice_limit", "channel"), &MidiPlayer::get_channel_voice_limit);
+	ClassDB::bind_method(D_METHOD("set_channel_priority", "channel", "priority"), &MidiPlayer::set_channel_priority);
+	ClassDB::bind_method(D_METHOD("get_channel_priority", "channel"), &MidiPlayer::get_channel_priority);
+
+	ClassDB::bind_method(D_METHOD("set_synthesis_rate_divisor", "divisor"), &MidiPlayer::set_synthesis_rate_divisor);
+	ClassDB::bind_method(D_METHOD("get_synthesis_rate_divisor"), &MidiPlayer::get_synthesis_rate_divisor);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::INT, "synthesis_rate_divisor", PROPERTY_HINT_ENUM, "Full:1,Half:2,Quarter:4"), "set_synthesis_rate_divisor", "get_synthesis_rate_divisor");
+
+	ClassDB::bind_method(D_METHOD("set_interpolation", "interpolation"), &MidiPlayer::set_interpolation);
+	ClassDB::bind_method(D_METHOD("get_interpolation"), &MidiPlayer::get_interpolation);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::INT, "interpolation", PROPERTY_HINT_ENUM, "Nearest,Linear,Cubic"), "set_interpolation", "get_interpolation");
+
+	ClassDB::bind_method(D_METHOD("set_adaptive_quality", "enable"), &MidiPlayer::set_adaptive_quality);
+	ClassDB::bind_method(D_METHOD("get_adaptive_quality"), &MidiPlayer::get_adaptive_quality);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::BOOL, "adaptive_quality"), "set_adaptive_quality", "get_adaptive_quality");
+
+	ClassDB::bind_method(D_METHOD("set_render_budget", "fraction"), &MidiPlayer::set_render_budget);
+	ClassDB::bind_method(D_METHOD("get_render_budget"), &MidiPlayer::get_render_budget);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::FLOAT, "render_budget", PROPERTY_HINT_RANGE, "0.05,1.0,0.01"), "set_render_budget", "get_render_budget");
+
+	ClassDB::bind_method(D_METHOD("get_quality_level"), &MidiPlayer::get_quality_level);
+	ADD_SIGNAL(MethodInfo("quality_level_changed", PropertyInfo(Variant::INT, "level")));
+	ADD_SIGNAL(MethodInfo("queued_midi_started"));
+
+	BIND_ENUM_CONSTANT(VOICE_STEAL_OLDEST);
+	BIND_ENUM_CONSTANT(VOICE_STEAL_QUIETEST);
+	BIND_ENUM_CONSTANT(VOICE_STEAL_LOWEST_PRIORITY);
+	BIND_ENUM_CONSTANT(VOICE_STEAL_RELEASED_FIRST);
+
+	BIND_ENUM_CONSTANT(INTERPOLATION_NEAREST);
+	BIND_ENUM_CONSTANT(INTERPOLATION_LINEAR);
+	BIND_ENUM_CONSTANT(INTERPOLATION_CUBIC);
+
 	ClassDB::bind_method(D_METHOD("set_audio_bus", "bus"), &MidiPlayer::set_audio_bus);
 	ClassDB::bind_method(D_METHOD("get_audio_bus"), &MidiPlayer::get_audio_bus);
 	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::STRING_NAME, "audio_bus"), "set_audio_bus", "get_audio_bus");
 
+	ClassDB::bind_method(D_METHOD("set_channel_muted", "channel", "muted"), &MidiPlayer::set_channel_muted);
+	ClassDB::bind_method(D_METHOD("is_channel_muted", "channel"), &MidiPlayer::is_channel_muted);
+	ClassDB::bind_method(D_METHOD("set_channel_solo", "channel", "solo"), &MidiPlayer::set_channel_solo);
+	ClassDB::bind_method(D_METHOD("is_channel_solo", "channel"), &MidiPlayer::is_channel_solo);
+
+	ClassDB::bind_method(D_METHOD("set_output_count", "count"), &MidiPlayer::set_output_count);
+	ClassDB::bind_method(D_METHOD("get_output_count"), &MidiPlayer::get_output_count);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::INT, "output_count", PROPERTY_HINT_RANGE, "1,8,1"), "set_output_count", "get_output_count");
+
+	ClassDB::bind_method(D_METHOD("set_output_bus", "output", "bus"), &MidiPlayer::set_output_bus);
+	ClassDB::bind_method(D_METHOD("get_output_bus", "output"), &MidiPlayer::get_output_bus);
+	ClassDB::bind_method(D_METHOD("set_channel_output", "channel", "output"), &MidiPlayer::set_channel_output);
+	ClassDB::bind_method(D_METHOD("get_channel_output", "channel"), &MidiPlayer::get_channel_output);
+
+	ClassDB::bind_method(D_METHOD("set_effect_sends", "enable"), &MidiPlayer::set_effect_sends);
+	ClassDB::bind_method(D_METHOD("get_effect_sends"), &MidiPlayer::get_effect_sends);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::BOOL, "effect_sends"), "set_effect_sends", "get_effect_sends");
+	ClassDB::bind_static_method("MidiPlayer", D_METHOD("set_bus_reverb", "bus", "room_size", "damping", "level"), &MidiPlayer::set_bus_reverb, DEFVAL(0.5f), DEFVAL(0.5f), DEFVAL(1.0f));
+	ClassDB::bind_static_method("MidiPlayer", D_METHOD("set_bus_chorus", "bus", "depth_ms", "rate_hz", "level"), &MidiPlayer::set_bus_chorus, DEFVAL(4.0f), DEFVAL(0.8f), DEFVAL(1.0f));
+
 	ClassDB::bind_method(D_METHOD("set_use_separate_notes_bus", "enable"), &MidiPlayer::set_use_separate_notes_bus);
 	ClassDB::bind_method(D_METHOD("get_use_separate_notes_bus"), &MidiPlayer::get_use_separate_notes_bus);
 	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::BOOL, "use_separate_notes_bus"), "set_use_separate_notes_bus", "get_use_separate_notes_bus");
@@ -81,6 +214,12 @@ void MidiPlayer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("load_midi", "path"), &MidiPlayer::load_midi);
 
 	ClassDB::bind_method(D_METHOD("play"), &MidiPlayer::play);
+	ClassDB::bind_method(D_METHOD("queue_midi", "resource", "at"), &MidiPlayer::queue_midi, DEFVAL("next_bar"));
+	ClassDB::bind_method(D_METHOD("cancel_queued_midi"), &MidiPlayer::cancel_queued_midi);
+	ClassDB::bind_method(D_METHOD("has_queued_midi"), &MidiPlayer::has_queued_midi);
+	ClassDB::bind_method(D_METHOD("set_beats_per_bar", "beats"), &MidiPlayer::set_beats_per_bar);
+	ClassDB::bind_method(D_METHOD("get_beats_per_bar"), &MidiPlayer::get_beats_per_bar);
+	ClassDB::add_property("MidiPlayer", PropertyInfo(Variant::INT, "beats_per_bar", PROPERTY_HINT_RANGE, "1,32,1"), "set_beats_per_bar", "get_beats_per_bar");
 	ClassDB::bind_method(D_METHOD("stop"), &MidiPlayer::stop);
 	ClassDB::bind_method(D_METHOD("pause"), &MidiPlayer::pause);
 	ClassDB::bind_method(D_METHOD("resume"), &MidiPlayer::resume);
@@ -90,11 +229,35 @@ void MidiPlayer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("note_off", "preset_index", "key"), &MidiPlayer::note_off);
 	ClassDB::bind_method(D_METHOD("note_off_all"), &MidiPlayer::note_off_all);
 
+	ClassDB::bind_method(D_METHOD("prerender_note", "preset_index", "key", "velocity", "duration_sec"), &MidiPlayer::prerender_note);
+	ClassDB::bind_method(D_METHOD("play_cached_note", "preset_index", "key", "velocity", "duration_sec", "volume_db"), &MidiPlayer::play_cached_note, DEFVAL(0.0f));
+	ClassDB::bind_method(D_METHOD("clear_note_cache"), &MidiPlayer::clear_note_cache);
+
 	ClassDB::bind_method(D_METHOD("get_length_seconds"), &MidiPlayer::get_length_seconds);
 	ClassDB::bind_method(D_METHOD("get_playback_position_seconds"), &MidiPlayer::get_playback_position_seconds);
+
+	ClassDB::bind_method(D_METHOD("is_culled"), &MidiPlayer::is_culled);
+	ClassDB::bind_method(D_METHOD("is_idle"), &MidiPlayer::is_idle);
+
+	ClassDB::bind_method(D_METHOD("get_notes_in_range", "from_sec", "to_sec", "channel_mask"), &MidiPlayer::get_notes_in_range, DEFVAL(0xFFFF));
+	ClassDB::bind_method(D_METHOD("get_note_count"), &MidiPlayer::get_note_count);
+
+	ClassDB::bind_method(D_METHOD("capture_state"), &MidiPlayer::capture_state);
+	ClassDB::bind_method(D_METHOD("restore_state", "state", "flush_audio"), &MidiPlayer::restore_state, DEFVAL(true));
+
+	ClassDB::bind_method(D_METHOD("get_performance_stats"), &MidiPlayer::get_performance_stats);
+	ClassDB::bind_method(D_METHOD("reset_performance_stats"), &MidiPlayer::reset_performance_stats);
+	ClassDB::bind_static_method("MidiPlayer", D_METHOD("start_trace", "events_per_thread"), &MidiPlayer::start_trace, DEFVAL(65536));
+	ClassDB::bind_static_method("MidiPlayer", D_METHOD("stop_trace"), &MidiPlayer::stop_trace);
+	ClassDB::bind_static_method("MidiPlayer", D_METHOD("is_tracing"), &MidiPlayer::is_tracing);
+	ClassDB::bind_static_method("MidiPlayer", D_METHOD("save_trace", "path"), &MidiPlayer::save_trace);
 }
 
 void MidiPlayer::note_on(int p_preset_index, int p_key, float p_velocity) {
+	_wake();
+	if (culled) {
+		return;
+	}
 	// Clamp velocity to 0.0-1.0 range
 	float vel = std::max(0.0f, std::min(1.0f, p_velocity));
 
@@ -115,7 +278,9 @@ void MidiPlayer::note_on(int p_preset_index, int p_key, float p_velocity) {
 			UtilityFunctions::push_warning("MidiPlayer: note_on called but no soundfont loaded.");
 			return;
 		}
-		tsf_note_on(notes_sf, p_preset_index, p_key, vel);
+		if (_make_room_for_voice(notes_sf, -1, tsfx_note_voice_count(notes_sf, p_preset_index, p_key, vel))) {
+			tsf_note_on(notes_sf, p_preset_index, p_key, vel);
+		}
 		return;
 	}
 
@@ -129,7 +294,10 @@ void MidiPlayer::note_on(int p_preset_index, int p_key, float p_velocity) {
 			return;
 		}
 	}
-	tsf_note_on(sf, p_preset_index, p_key, vel);
+	if (_make_room_for_voice(sf, -1, tsfx_note_voice_count(sf, p_preset_index, p_key, vel))) {
+		tsf_note_on(sf, p_preset_index, p_key, vel);
+	}
+	loop_cache_epoch++;
 }
 
 void MidiPlayer::note_off(int p_preset_index, int p_key) {
@@ -144,6 +312,7 @@ void MidiPlayer::note_off(int p_preset_index, int p_key) {
 		return;
 	}
 	tsf_note_off(sf, p_preset_index, p_key);
+	loop_cache_epoch++;
 }
 
 void MidiPlayer::note_off_all() {
@@ -158,14 +327,143 @@ void MidiPlayer::note_off_all() {
 		return;
 	}
 	tsf_note_off_all(sf);
+	loop_cache_epoch++;
+}
+
+Ref<AudioStreamWAV> MidiPlayer::prerender_note(int p_preset_index, int p_key, float p_velocity, float p_duration_sec) {
+	const int key = std::max(0, std::min(127, p_key));
+	const int vel = (int)(std::max(0.0f, std::min(1.0f, p_velocity)) * 127.0f + 0.5f);
+	const uint32_t duration_ms = (uint32_t)(std::max(0.0f, p_duration_sec) * 1000.0f);
+
+	if (!sf && soundfont_resource.is_valid() && !soundfont_resource->get_data().is_empty()) {
+		_load_soundfont_bytes(soundfont_resource->get_data());
+	}
+	if (!sf) {
+		UtilityFunctions::push_warning("MidiPlayer: prerender_note called but no soundfont loaded.");
+		return Ref<AudioStreamWAV>();
+	}
+	// An unknown preset starts no voice and would cache an empty clip. The cache key
+	// holds 16 bits of preset index.
+	if (p_preset_index < 0 || p_preset_index >= tsf_get_presetcount(sf) || p_preset_index > 0xFFFF) {
+		UtilityFunctions::push_error(String("MidiPlayer: prerender_note() preset index out of range: ") + String::num_int64(p_preset_index));
+		return Ref<AudioStreamWAV>();
+	}
+
+	const uint64_t cache_key = ((uint64_t)p_preset_index << 48) | ((uint64_t)key << 40) | ((uint64_t)vel << 32) | duration_ms;
+	if (const Ref<AudioStreamWAV> *cached = note_cache.getptr(cache_key)) {
+		return *cached;
+	}
+
+	// A copy shares the sample data but has its own voices, so playback is undisturbed.
+	tsf *synth = tsf_copy(sf);
+	if (!synth) {
+		return Ref<AudioStreamWAV>();
+	}
+	tsf_set_output(synth, TSF_STEREO_INTERLEAVED, sample_rate, 0.0f);
+	// The copy carries the player volume; clips are rendered at unity and scaled at playback.
+	tsf_set_volume(synth, 1.0f);
+	tsf_set_max_voices(synth, 16);
+
+	std::vector<float> rendered;
+	float block[k_block_frames * 2];
+	const int hold_frames = (int)((double)duration_ms * sample_rate / 1000.0);
+	const int max_frames = hold_frames + (int)(k_max_one_shot_tail_sec * sample_rate);
+
+	tsf_note_on(synth, p_preset_index, key, (float)vel / 127.0f);
+	int frames_done = 0;
+	bool released = false;
+	MidiDenormalScope denormals;
+	while (frames_done < max_frames) {
+		if (!released && frames_done >= hold_frames) {
+			tsf_note_off(synth, p_preset_index, key);
+			released = true;
+		}
+		if (released && tsf_active_voice_count(synth) == 0) {
+			break;
+		}
+		int frames = std::min(k_block_frames, max_frames - frames_done);
+		if (!released) {
+			frames = std::min(frames, hold_frames - frames_done);
+		}
+		tsf_render_float(synth, block, frames, 0);
+		rendered.insert(rendered.end(), block, block + frames * 2);
+		frames_done += frames;
+	}
+	tsf_close(synth);
+
+	PackedByteArray pcm;
+	pcm.resize((int64_t)rendered.size() * 2);
+	int16_t *pcm_w = (int16_t *)pcm.ptrw();
+	for (size_t i = 0; i < rendered.size(); i++) {
+		const float v = std::max(-1.0f, std::min(1.0f, rendered[i]));
+		pcm_w[i] = (int16_t)(v * 32767.0f);
+	}
+
+	Ref<AudioStreamWAV> stream;
+	stream.instantiate();
+	stream->set_format(AudioStreamWAV::FORMAT_16_BITS);
+	stream->set_stereo(true);
+	stream->set_mix_rate(sample_rate);
+	stream->set_data(pcm);
+
+	note_cache.insert(cache_key, stream);
+	return stream;
+}
+
+int MidiPlayer::play_cached_note(int p_preset_index, int p_key, float p_velocity, float p_duration_sec, float p_volume_db) {
+	if (culled) {
+		return -1;
+	}
+	Ref<AudioStreamWAV> stream = prerender_note(p_preset_index, p_key, p_velocity, p_duration_sec);
+	if (stream.is_null()) {
+		return -1;
+	}
+	_ensure_one_shot_setup();
+	AudioStreamPlaybackPolyphonic *poly = Object::cast_to<AudioStreamPlaybackPolyphonic>(one_shot_playback.ptr());
+	if (!poly) {
+		return -1;
+	}
+	// Player volume is linear gain; fold it into the per-stream dB volume.
+	const float gain_db = volume > 0.0f ? 20.0f * std::log10(volume) : -80.0f;
+	return (int)poly->play_stream(stream, 0.0f, p_volume_db + gain_db, 1.0f);
+}
+
+void MidiPlayer::clear_note_cache() {
+	note_cache.clear();
+}
+
+void MidiPlayer::_ensure_one_shot_setup() {
+	if (!one_shot_player.is_valid()) {
+		Node *node = _create_output_node();
+		node->set_name("_MidiPlayerOneShots");
+		add_child(node);
+		one_shot_player = MidiAudioOutput(node);
+
+		Ref<AudioStreamPolyphonic> stream;
+		stream.instantiate();
+		stream->set_polyphony(k_one_shot_polyphony);
+		one_shot_player.set_stream(stream);
+	}
+	one_shot_player.set_bus(use_separate_notes_bus ? notes_audio_bus : audio_bus);
+
+	if (!one_shot_player.is_playing()) {
+		one_shot_player.play();
+		one_shot_playback = one_shot_player.get_stream_playback();
+	}
+}
+
+void MidiPlayer::_enter_tree() {
+	MidiPerformanceMonitors::add_player(this);
 }
 
 void MidiPlayer::_ready() {
-	_ensure_audio_setup();
+	// Outputs join the mix on the first play() or note_on(), not on entering the tree.
 }
 
 void MidiPlayer::_exit_tree() {
+	MidiPerformanceMonitors::remove_player(this);
 	stop();
+	_leave_effect_buses();
 }
 
 void MidiPlayer::set_soundfont(const Ref<SoundFontResource> &p_resource) {
@@ -174,7 +472,7 @@ void MidiPlayer::set_soundfont(const Ref<SoundFontResource> &p_resource) {
 		const PackedByteArray bytes = soundfont_resource->get_data();
 		if (!bytes.is_empty()) {
 			_load_soundfont_bytes(bytes);
-			if (use_separate_notes_bus && notes_player) {
+			if (use_separate_notes_bus && notes_player.is_valid()) {
 				_ensure_notes_audio_setup();
 				_load_notes_soundfont_bytes(soundfont_bytes_cache);
 			}
@@ -200,6 +498,43 @@ Ref<MidiFileResource> MidiPlayer::get_midi() const {
 	return midi_resource;
 }
 
+void MidiPlayer::set_sequence(const Ref<MidiSequence> &p_sequence) {
+	if (p_sequence == sequence) {
+		return;
+	}
+	cancel_queued_midi();
+	loop_cache_epoch++;
+	sequence = p_sequence;
+	sequence_last = nullptr;
+	sequence_generation = sequence.is_valid() ? sequence->get_events().get_generation() : 0;
+	// Whatever was playing stops; the new source starts from its beginning.
+	if (playing) {
+		if (_has_sequence()) {
+			play();
+		} else {
+			// Nothing left to play: a looping player would otherwise keep wrapping an empty source.
+			stop();
+		}
+	}
+}
+
+Ref<MidiSequence> MidiPlayer::get_sequence() const {
+	return sequence;
+}
+
+void MidiPlayer::set_stream_threshold_kb(int p_kb) {
+	// Applies to the next load.
+	stream_threshold_kb = std::max(0, p_kb);
+}
+
+int MidiPlayer::get_stream_threshold_kb() const {
+	return stream_threshold_kb;
+}
+
+bool MidiPlayer::is_streaming() const {
+	return streaming;
+}
+
 void MidiPlayer::set_loop(bool p_loop) {
 	loop = p_loop;
 }
@@ -216,6 +551,27 @@ bool MidiPlayer::is_looping() const {
 	return loop;
 }
 
+void MidiPlayer::set_loop_cache_mb(float p_mb) {
+	loop_cache_mb = std::max(0.0f, std::min(k_max_loop_cache_mb, p_mb));
+	if (loop_cache_mb > 0.0f) {
+		// A new budget applies from the next recording.
+		return;
+	}
+	if (loop_cache_replaying) {
+		_leave_loop_cache_replay();
+	}
+	loop_cache_fade = nullptr;
+	loop_cache.release();
+}
+
+float MidiPlayer::get_loop_cache_mb() const {
+	return loop_cache_mb;
+}
+
+bool MidiPlayer::is_loop_cache_replaying() const {
+	return loop_cache_replaying;
+}
+
 void MidiPlayer::set_midi_speed(float p_speed) {
 	if (p_speed <= 0.0f) {
 		p_speed = 1.0f;
@@ -243,25 +599,179 @@ float MidiPlayer::get_volume() const {
 
 void MidiPlayer::set_generator_buffer_length(float p_seconds) {
 	generator_buffer_length = std::max(0.05f, p_seconds);
+	buffer_target_length = std::max(std::min(buffer_target_length, generator_buffer_length), std::min(min_buffer_length, generator_buffer_length));
+	buffer_capacity_frames = 0;
 	if (generator.is_valid()) {
 		generator->set_buffer_length(generator_buffer_length);
 	}
 	if (notes_generator.is_valid()) {
 		notes_generator->set_buffer_length(generator_buffer_length);
 	}
+	for (StemOutput &stem : stems) {
+		if (stem.generator.is_valid()) {
+			stem.generator->set_buffer_length(generator_buffer_length);
+		}
+	}
 }
 
 float MidiPlayer::get_generator_buffer_length() const {
 	return generator_buffer_length;
 }
 
+void MidiPlayer::set_adaptive_buffer(bool p_enable) {
+	adaptive_buffer = p_enable;
+	// Start from the full buffer and let it shrink; starting low would underrun first.
+	buffer_target_length = generator_buffer_length;
+	buffer_calm_sec = 0.0;
+	buffer_underruns_seen = perf_stats.underruns;
+}
+
+bool MidiPlayer::get_adaptive_buffer() const {
+	return adaptive_buffer;
+}
+
+void MidiPlayer::set_min_buffer_length(float p_seconds) {
+	min_buffer_length = std::max(0.01f, p_seconds);
+	buffer_target_length = std::max(buffer_target_length, std::min(min_buffer_length, generator_buffer_length));
+}
+
+float MidiPlayer::get_min_buffer_length() const {
+	return min_buffer_length;
+}
+
+float MidiPlayer::get_buffer_target_length() const {
+	return adaptive_buffer ? buffer_target_length : generator_buffer_length;
+}
+
+void MidiPlayer::set_max_voices(int p_max_voices) {
+	max_voices = std::max(1, std::min(1024, p_max_voices));
+	// TSF only ever grows its pool; lowering the cap is enforced by the dispatcher.
+	if (sf) {
+		tsf_set_max_voices(sf, max_voices);
+	}
+	if (notes_sf) {
+		tsf_set_max_voices(notes_sf, max_voices);
+	}
+}
+
+int MidiPlayer::get_max_voices() const {
+	return max_voices;
+}
+
+void MidiPlayer::set_voice_steal_policy(VoiceStealPolicy p_policy) {
+	dispatcher.steal_policy = std::max((int)VOICE_STEAL_OLDEST, std::min((int)VOICE_STEAL_RELEASED_FIRST, (int)p_policy));
+}
+
+MidiPlayer::VoiceStealPolicy MidiPlayer::get_voice_steal_policy() const {
+	return (VoiceStealPolicy)dispatcher.steal_policy;
+}
+
+void MidiPlayer::set_channel_voice_limit(int p_channel, int p_limit) {
+	if (p_channel < 0 || p_channel >= 16) {
+		UtilityFunctions::push_error("MidiPlayer: channel out of range (0-15).");
+		return;
+	}
+	dispatcher.channel_voice_limits[p_channel] = std::max(0, p_limit);
+}
+
+int MidiPlayer::get_channel_voice_limit(int p_channel) const {
+	if (p_channel < 0 || p_channel >= 16) {
+		return 0;
+	}
+	return dispatcher.channel_voice_limits[p_channel];
+}
+
+void MidiPlayer::set_channel_priority(int p_channel, int p_priority) {
+	if (p_channel < 0 || p_channel >= 16) {
+		UtilityFunctions::push_error("MidiPlayer: channel out of range (0-15).");
+		return;
+	}
+	dispatcher.channel_priorities[p_channel] = p_priority;
+}
+
+int MidiPlayer::get_channel_priority(int p_channel) const {
+	if (p_channel < 0 || p_channel >= 16) {
+		return 0;
+	}
+	return dispatcher.channel_priorities[p_channel];
+}
+
+void MidiPlayer::set_synthesis_rate_divisor(int p_divisor) {
+	const int divisor = p_divisor >= 4 ? 4 : (p_divisor >= 2 ? 2 : 1);
+	if (divisor == synthesis_rate_divisor) {
+		return;
+	}
+	synthesis_rate_divisor = divisor;
+	upsampler.configure(synthesis_rate_divisor, k_block_frames);
+	upsampler.reset();
+	notes_upsampler.configure(synthesis_rate_divisor, k_block_frames);
+	notes_upsampler.reset();
+	for (StemOutput &stem : stems) {
+		stem.upsampler.configure(synthesis_rate_divisor, k_block_frames);
+		stem.upsampler.reset();
+	}
+	// TSF fixes a voice's pitch step and envelope rates at note-on, so sounding
+	// voices would play at the wrong pitch and speed: restart what the sequence holds.
+	_cancel_loop_cache_pass();
+	if (sf) {
+		tsfx_kill_all_voices(sf);
+		tsf_set_output(sf, TSF_STEREO_INTERLEAVED, _get_synth_sample_rate(), 0.0f);
+	}
+	if (notes_sf) {
+		tsfx_kill_all_voices(notes_sf);
+		tsf_set_output(notes_sf, TSF_STEREO_INTERLEAVED, _get_synth_sample_rate(), 0.0f);
+	}
+	_retrigger_held_notes(0xFFFF);
+}
+
+int MidiPlayer::get_synthesis_rate_divisor() const {
+	return synthesis_rate_divisor;
+}
+
+void MidiPlayer::set_interpolation(Interpolation p_interpolation) {
+	interpolation = (Interpolation)std::max((int)INTERPOLATION_NEAREST, std::min((int)INTERPOLATION_CUBIC, (int)p_interpolation));
+}
+
+MidiPlayer::Interpolation MidiPlayer::get_interpolation() const {
+	return interpolation;
+}
+
+void MidiPlayer::set_adaptive_quality(bool p_enable) {
+	adaptive_quality = p_enable;
+	render_usec_accum = 0;
+	render_frames_accum = 0;
+	notes_render_frames_accum = 0;
+	quality_calm_frames = 0;
+	quality_busy_frames = 0;
+	if (!adaptive_quality && quality_level != 0) {
+		quality_level = 0;
+		emit_signal("quality_level_changed", quality_level);
+	}
+}
+
+bool MidiPlayer::get_adaptive_quality() const {
+	return adaptive_quality;
+}
+
+void MidiPlayer::set_render_budget(float p_fraction) {
+	render_budget = std::max(0.05f, std::min(1.0f, p_fraction));
+}
+
+float MidiPlayer::get_render_budget() const {
+	return render_budget;
+}
+
+int MidiPlayer::get_quality_level() const {
+	return quality_level;
+}
+
 void MidiPlayer::set_audio_bus(const StringName &p_bus) {
 	audio_bus = p_bus;
-	if (player) {
-		player->set_bus(audio_bus);
+	if (player.is_valid()) {
+		player.set_bus(audio_bus);
 	}
-	if (!use_separate_notes_bus && notes_player) {
-		notes_player->set_bus(audio_bus);
+	if (!use_separate_notes_bus && notes_player.is_valid()) {
+		notes_player.set_bus(audio_bus);
 	}
 }
 
@@ -269,6 +779,251 @@ StringName MidiPlayer::get_audio_bus() const {
 	return audio_bus;
 }
 
+void MidiPlayer::set_channel_muted(int p_channel, bool p_muted) {
+	if (p_channel < 0 || p_channel >= 16) {
+		UtilityFunctions::push_error("MidiPlayer: channel out of range (0-15).");
+		return;
+	}
+	const uint16_t bit = (uint16_t)(1u << p_channel);
+	const uint16_t muted = dispatcher.muted_channels;
+	_set_audible_mask(p_muted ? (uint16_t)(muted | bit) : (uint16_t)(muted & ~bit), dispatcher.solo_channels);
+}
+
+bool MidiPlayer::is_channel_muted(int p_channel) const {
+	if (p_channel < 0 || p_channel >= 16) {
+		return false;
+	}
+	return (dispatcher.muted_channels >> p_channel) & 1;
+}
+
+void MidiPlayer::set_channel_solo(int p_channel, bool p_solo) {
+	if (p_channel < 0 || p_channel >= 16) {
+		UtilityFunctions::push_error("MidiPlayer: channel out of range (0-15).");
+		return;
+	}
+	const uint16_t bit = (uint16_t)(1u << p_channel);
+	const uint16_t solo = dispatcher.solo_channels;
+	_set_audible_mask(dispatcher.muted_channels, p_solo ? (uint16_t)(solo | bit) : (uint16_t)(solo & ~bit));
+}
+
+bool MidiPlayer::is_channel_solo(int p_channel) const {
+	if (p_channel < 0 || p_channel >= 16) {
+		return false;
+	}
+	return (dispatcher.solo_channels >> p_channel) & 1;
+}
+
+void MidiPlayer::_set_audible_mask(uint16_t p_muted, uint16_t p_solo) {
+	const uint16_t was_audible = dispatcher.get_audible_mask();
+	dispatcher.muted_channels = p_muted;
+	dispatcher.solo_channels = p_solo;
+	const uint16_t now_audible = dispatcher.get_audible_mask();
+
+	if (sf) {
+		// Silenced channels fade out within a few milliseconds and then cost nothing.
+		const uint16_t silenced = was_audible & ~now_audible;
+		for (int ch = 0; ch < 16; ch++) {
+			if (silenced & (1u << ch)) {
+				tsf_channel_sounds_off_all(sf, ch);
+			}
+		}
+	}
+	if (!culled) {
+		_retrigger_held_notes(now_audible & ~was_audible);
+	}
+}
+
+void MidiPlayer::_retrigger_held_notes(uint16_t p_channel_mask) {
+	// Notes still held by the sequence start sounding right away instead of
+	// waiting for their next note-on. A replayed loop pass restarts them all when it ends.
+	if (!sf || !playing || loop_cache_replaying) {
+		return;
+	}
+	dispatcher.voice_cap = _get_effective_max_voices();
+	dispatcher.retrigger_held_notes(sf, p_channel_mask);
+}
+
+void MidiPlayer::set_output_count(int p_count) {
+	p_count = std::max(1, std::min(k_max_outputs, p_count));
+	while ((int)stems.size() > p_count - 1) {
+		StemOutput &stem = stems.back();
+		if (stem.output.is_valid()) {
+			stem.output.stop();
+			stem.output.get_node()->queue_free();
+		}
+		stems.pop_back();
+	}
+	while ((int)stems.size() < p_count - 1) {
+		stems.emplace_back();
+		stems.back().upsampler.configure(synthesis_rate_divisor, k_block_frames);
+	}
+	if (player.is_valid()) {
+		_ensure_stem_outputs();
+	}
+}
+
+int MidiPlayer::get_output_count() const {
+	return 1 + (int)stems.size();
+}
+
+void MidiPlayer::set_output_bus(int p_output, const StringName &p_bus) {
+	if (p_output == 0) {
+		set_audio_bus(p_bus);
+		return;
+	}
+	if (p_output < 0 || p_output > (int)stems.size()) {
+		UtilityFunctions::push_error("MidiPlayer: output index out of range.");
+		return;
+	}
+	StemOutput &stem = stems[p_output - 1];
+	stem.bus = p_bus;
+	if (stem.output.is_valid()) {
+		stem.output.set_bus(p_bus);
+	}
+}
+
+StringName MidiPlayer::get_output_bus(int p_output) const {
+	if (p_output <= 0 || p_output > (int)stems.size()) {
+		return audio_bus;
+	}
+	return stems[p_output - 1].bus;
+}
+
+void MidiPlayer::set_channel_output(int p_channel, int p_output) {
+	if (p_channel < 0 || p_channel >= 16) {
+		UtilityFunctions::push_error("MidiPlayer: channel out of range (0-15).");
+		return;
+	}
+	// Routes past output_count fall back to output 0 at render time.
+	channel_outputs[p_channel] = std::max(0, std::min(k_max_outputs - 1, p_output));
+}
+
+int MidiPlayer::get_channel_output(int p_channel) const {
+	if (p_channel < 0 || p_channel >= 16) {
+		return 0;
+	}
+	return channel_outputs[p_channel];
+}
+
+void MidiPlayer::set_effect_sends(bool p_enable) {
+	effect_sends = p_enable;
+	if (!effect_sends) {
+		_leave_effect_buses();
+	}
+}
+
+bool MidiPlayer::get_effect_sends() const {
+	return effect_sends;
+}
+
+void MidiPlayer::set_bus_reverb(const StringName &p_bus, float p_room_size, float p_damping, float p_level) {
+	MidiEffectBuses::set_reverb(p_bus, p_room_size, p_damping, p_level);
+}
+
+void MidiPlayer::set_bus_chorus(const StringName &p_bus, float p_depth_ms, float p_rate_hz, float p_level) {
+	MidiEffectBuses::set_chorus(p_bus, p_depth_ms, p_rate_hz, p_level);
+}
+
+void MidiPlayer::_update_effect_sends() {
+	const bool rendering = sf && ((playing && !paused) || tsf_active_voice_count(sf) > 0);
+	const int wanted = effect_sends && rendering ? 1 + (int)stems.size() : 0;
+	while ((int)effect_send_outputs.size() > wanted) {
+		MidiEffectBuses::leave(effect_send_outputs.back().slot);
+		effect_send_outputs.pop_back();
+	}
+	effect_send_outputs.resize(wanted);
+	for (int o = 0; o < wanted; o++) {
+		EffectSendOutput &send = effect_send_outputs[o];
+		const StringName bus = get_output_bus(o);
+		if (send.slot >= 0 && send.bus == bus) {
+			continue;
+		}
+		MidiEffectBuses::leave(send.slot);
+		send = EffectSendOutput();
+		send.bus = bus;
+		send.slot = MidiEffectBuses::join(bus, sample_rate, send.cursor);
+	}
+}
+
+void MidiPlayer::_leave_effect_buses() {
+	for (const EffectSendOutput &send : effect_send_outputs) {
+		MidiEffectBuses::leave(send.slot);
+	}
+	effect_send_outputs.clear();
+}
+
+void MidiPlayer::_render_with_sends(tsf *p_synth, float *const *p_buffers, int p_buffer_count, int p_frames) {
+	const size_t block = (size_t)k_block_frames * 2;
+	float *channels[17];
+	for (int i = 0; i < 17; i++) {
+		channels[i] = channel_blocks.data() + i * block;
+	}
+	const unsigned int used = tsfx_render_float_channels(p_synth, channels, p_frames, _get_effective_interpolation());
+
+	const int samples = p_frames * 2;
+	for (int o = 0; o < p_buffer_count; o++) {
+		std::fill(p_buffers[o], p_buffers[o] + samples, 0.0f);
+	}
+	std::fill(send_blocks.begin(), send_blocks.begin() + (size_t)p_buffer_count * 2 * block, 0.0f);
+
+	// Mixing per channel instead of per voice keeps the send cost independent of polyphony.
+	for (int index = 0; index < 17; index++) {
+		if (!(used & (1u << index))) {
+			continue;
+		}
+		int target = index < 16 ? channel_outputs[index] : 0;
+		if (target < 0 || target >= p_buffer_count) {
+			target = 0;
+		}
+		const float *src = channels[index];
+		float *dry = p_buffers[target];
+		for (int i = 0; i < samples; i++) {
+			dry[i] += src[i];
+		}
+		if (index == 16) {
+			continue;
+		}
+		const float sends[2] = { dispatcher.reverb_sends[index] * (1.0f / 127.0f), dispatcher.chorus_sends[index] * (1.0f / 127.0f) };
+		for (int s = 0; s < 2; s++) {
+			if (sends[s] <= 0.0f) {
+				continue;
+			}
+			float *out = send_blocks.data() + ((size_t)target * 2 + s) * block;
+			for (int i = 0; i < samples; i++) {
+				out[i] += src[i] * sends[s];
+			}
+		}
+	}
+}
+
+void MidiPlayer::_push_effect_sends(int p_output, int p_synth_frames, int p_divisor) {
+	EffectSendOutput &send = effect_send_outputs[p_output];
+	const size_t block = (size_t)k_block_frames * 2;
+	const float *reverb = send_blocks.data() + (size_t)p_output * 2 * block;
+	const float *chorus = reverb + block;
+	if (p_divisor > 1) {
+		// Linear interpolation is enough for a signal that only feeds reverb and chorus.
+		for (int s = 0; s < 2; s++) {
+			const float *src = s == 0 ? reverb : chorus;
+			float *dst = send_upsampled.data() + s * block;
+			float *last = send.last + s * 2;
+			for (int f = 0; f < p_synth_frames; f++) {
+				for (int k = 0; k < p_divisor; k++) {
+					const float t = (float)(k + 1) / (float)p_divisor;
+					const int at = (f * p_divisor + k) * 2;
+					dst[at] = last[0] + (src[f * 2] - last[0]) * t;
+					dst[at + 1] = last[1] + (src[f * 2 + 1] - last[1]) * t;
+				}
+				last[0] = src[f * 2];
+				last[1] = src[f * 2 + 1];
+			}
+		}
+		reverb = send_upsampled.data();
+		chorus = send_upsampled.data() + block;
+	}
+	MidiEffectBuses::add_sends(send.slot, send.cursor, reverb, chorus, p_synth_frames * p_divisor);
+}
+
 void MidiPlayer::set_use_separate_notes_bus(bool p_enable) {
 	use_separate_notes_bus = p_enable;
 	if (!use_separate_notes_bus) {
@@ -276,9 +1031,9 @@ void MidiPlayer::set_use_separate_notes_bus(bool p_enable) {
 			tsf_note_off_all(notes_sf);
 			tsf_reset(notes_sf);
 		}
-		if (notes_player) {
-			notes_player->stop();
-			notes_player->set_bus(audio_bus);
+		if (notes_player.is_valid()) {
+			notes_player.stop();
+			notes_player.set_bus(audio_bus);
 		}
 		notes_playback_base.unref();
 		notes_playback = nullptr;
@@ -291,8 +1046,8 @@ bool MidiPlayer::get_use_separate_notes_bus() const {
 
 void MidiPlayer::set_notes_audio_bus(const StringName &p_bus) {
 	notes_audio_bus = p_bus;
-	if (notes_player) {
-		notes_player->set_bus(use_separate_notes_bus ? notes_audio_bus : audio_bus);
+	if (notes_player.is_valid()) {
+		notes_player.set_bus(use_separate_notes_bus ? notes_audio_bus : audio_bus);
 	}
 }
 
@@ -323,12 +1078,14 @@ PackedByteArray MidiPlayer::_read_all_bytes(const String &p_path) {
 }
 
 bool MidiPlayer::_load_soundfont_bytes(const PackedByteArray &p_bytes) {
+	MidiTraceScope trace("MidiPlayer::load_soundfont");
 	if (p_bytes.is_empty()) {
 		UtilityFunctions::push_error("MidiPlayer: SoundFont bytes are empty.");
 		return false;
 	}
 
 	soundfont_bytes_cache = p_bytes;
+	loop_cache_epoch++;
 
 	if (sf) {
 		tsf_close(sf);
@@ -350,66 +1107,211 @@ bool MidiPlayer::_load_soundfont_bytes(const PackedByteArray &p_bytes) {
 		sample_rate = 44100;
 	}
 
-	tsf_set_output(sf, TSF_STEREO_INTERLEAVED, sample_rate, 0.0f);
-	tsf_set_max_voices(sf, 256);
-	tsf_set_volume(sf, volume);
+	_configure_synth(sf);
+	return true;
+}
+
+int MidiPlayer::_get_synth_sample_rate() const {
+	return sample_rate / synthesis_rate_divisor;
+}
+
+void MidiPlayer::_configure_synth(tsf *p_synth) {
+	tsf_set_output(p_synth, TSF_STEREO_INTERLEAVED, _get_synth_sample_rate(), 0.0f);
+	// Pre-allocate the voice pool so note-ons never reallocate during playback.
+	tsf_set_max_voices(p_synth, max_voices);
+	tsf_set_volume(p_synth, volume);
 
 	// Initialize channels so channel allocation won't happen during playback.
 	for (int ch = 0; ch < 16; ch++) {
 		// Default program 0, drums on channel 9.
-		tsf_channel_set_presetnumber(sf, ch, 0, ch == 9);
+		tsf_channel_set_presetnumber(p_synth, ch, 0, ch == 9);
 		// Set center pan + full volume in TSF's MIDI controller space.
-		tsf_channel_midi_control(sf, ch, (int)TML_PAN_MSB, 64);
-		tsf_channel_midi_control(sf, ch, (int)TML_VOLUME_MSB, 127);
+		tsf_channel_midi_control(p_synth, ch, (int)TML_PAN_MSB, 64);
+		tsf_channel_midi_control(p_synth, ch, (int)TML_VOLUME_MSB, 127);
 	}
+}
 
-	return true;
+bool MidiPlayer::_make_room_for_voice(tsf *p_synth, int p_channel, int p_voices) {
+	dispatcher.voice_cap = _get_effective_max_voices();
+	return dispatcher.make_room_for_voice(p_synth, p_channel, p_voices);
 }
 
-bool MidiPlayer::_load_notes_soundfont_bytes(const PackedByteArray &p_bytes) {
-	if (p_bytes.is_empty()) {
-		return false;
+int MidiPlayer::_get_effective_max_voices() const {
+	int cap = max_voices;
+	if (quality_level > 0) {
+		// Each degradation level halves the voice budget.
+		cap = std::max(std::min(max_voices, k_min_degraded_voices), max_voices >> quality_level);
 	}
-
-	if (notes_sf) {
-		tsf_close(notes_sf);
-		notes_sf = nullptr;
+	if (lod_voice_cap > 0) {
+		cap = std::min(cap, lod_voice_cap);
 	}
+	return cap;
+}
 
-	notes_sf = tsf_load_memory(p_bytes.ptr(), (int)p_bytes.size());
-	if (!notes_sf) {
-		UtilityFunctions::push_error("MidiPlayer: notes tsf_load_memory() failed.");
-		return false;
+void MidiPlayer::_cull_voices(tsf *p_synth, int p_keep) {
+	if (!p_synth) {
+		return;
+	}
+	while (tsfx_voice_count(p_synth, -1) > p_keep) {
+		const int voice = tsfx_pick_steal_voice(p_synth, TSFX_STEAL_QUIETEST, -1, dispatcher.channel_priorities, INT_MAX);
+		if (voice < 0) {
+			break;
+		}
+		tsfx_voice_kill(p_synth, voice);
 	}
+}
 
-	sample_rate = (int)AudioServer::get_singleton()->get_mix_rate();
-	if (sample_rate <= 0) {
-		sample_rate = 44100;
+void MidiPlayer::_apply_quality_to_block(tsf *p_synth) {
+	if (quality_level >= 2) {
+		tsfx_drop_release_filters(p_synth);
+	}
+	if (quality_level >= 3) {
+		tsfx_kill_quiet_released_voices(p_synth, k_quiet_release_gain);
 	}
+}
 
-	tsf_set_output(notes_sf, TSF_STEREO_INTERLEAVED, sample_rate, 0.0f);
-	tsf_set_max_voices(notes_sf, 256);
-	tsf_set_volume(notes_sf, volume);
+int MidiPlayer::_get_effective_interpolation() const {
+	// Each degradation level (and far distance LOD) lowers the interpolation order by one step.
+	const int interp = std::max((int)INTERPOLATION_NEAREST, (int)interpolation - quality_level - lod_interpolation_drop);
+	switch (interp) {
+		case INTERPOLATION_NEAREST:
+			return TSFX_INTERP_NEAREST;
+		case INTERPOLATION_CUBIC:
+			return TSFX_INTERP_CUBIC;
+		default:
+			return TSFX_INTERP_LINEAR;
+	}
+}
 
-	for (int ch = 0; ch < 16; ch++) {
-		tsf_channel_set_presetnumber(notes_sf, ch, 0, ch == 9);
-		tsf_channel_midi_control(notes_sf, ch, (int)TML_PAN_MSB, 64);
-		tsf_channel_midi_control(notes_sf, ch, (int)TML_VOLUME_MSB, 127);
+void MidiPlayer::_render_synth(tsf *p_synth, float *const *p_buffers, int p_buffer_count, int p_frames) {
+	_apply_quality_to_block(p_synth);
+	MidiTraceScope trace("tsf_render_float");
+	if (trace.is_active()) {
+		trace.voices = tsf_active_voice_count(p_synth);
+	}
+	const uint64_t render_start = Time::get_singleton()->get_ticks_usec();
+	if (p_synth == sf && (int)effect_send_outputs.size() == p_buffer_count) {
+		_render_with_sends(p_synth, p_buffers, p_buffer_count, p_frames);
+	} else if (p_buffer_count <= 1) {
+		tsfx_render_float(p_synth, p_buffers[0], p_frames, 0, _get_effective_interpolation());
+	} else {
+		tsfx_render_float_routed(p_synth, p_buffers, p_buffer_count, channel_outputs, p_frames, _get_effective_interpolation());
+	}
+	const uint64_t elapsed = Time::get_singleton()->get_ticks_usec() - render_start;
+	render_usec_accum += elapsed;
+	perf_render_usec += elapsed;
+	perf_render_blocks++;
+}
+
+void MidiPlayer::_update_adaptive_quality() {
+	// Both synths render the same stretch of wall time, so the audio duration is the longer of the two.
+	const uint64_t frames_rendered = std::max(render_frames_accum, notes_render_frames_accum);
+	if (frames_rendered == 0) {
+		return;
+	}
+	if (!adaptive_quality) {
+		render_usec_accum = 0;
+		render_frames_accum = 0;
+		notes_render_frames_accum = 0;
+		return;
+	}
+
+	const double audio_usec = (double)frames_rendered * 1000000.0 / (double)sample_rate;
+	const double load = (double)render_usec_accum / audio_usec;
+	const int frames = (int)frames_rendered;
+	render_usec_accum = 0;
+	render_frames_accum = 0;
+	notes_render_frames_accum = 0;
+
+	int new_level = quality_level;
+	if (load > render_budget) {
+		// A single slow frame (a burst of note-ons, a page fault) is not worth a level.
+		quality_calm_frames = 0;
+		quality_busy_frames += frames;
+		if (quality_busy_frames >= (int)(sample_rate * k_quality_busy_sec)) {
+			quality_busy_frames = 0;
+			new_level = std::min(k_max_quality_level, quality_level + 1);
+		}
+	} else if (load < render_budget * 0.5) {
+		// Only restore quality after a full second of comfortable headroom.
+		quality_busy_frames = 0;
+		quality_calm_frames += frames;
+		if (quality_calm_frames >= (int)(sample_rate * k_quality_calm_sec)) {
+			quality_calm_frames = 0;
+			new_level = std::max(0, quality_level - 1);
+		}
+	} else {
+		quality_calm_frames = 0;
+	}
+
+	if (new_level == quality_level) {
+		return;
+	}
+	quality_level = new_level;
+	_cull_voices(sf, _get_effective_max_voices());
+	_cull_voices(notes_sf, _get_effective_max_voices());
+	emit_signal("quality_level_changed", quality_level);
+}
+
+bool MidiPlayer::_load_notes_soundfont_bytes(const PackedByteArray &p_bytes) {
+	MidiTraceScope trace("MidiPlayer::load_notes_soundfont");
+	if (p_bytes.is_empty()) {
+		return false;
+	}
+
+	if (notes_sf) {
+		tsf_close(notes_sf);
+		notes_sf = nullptr;
+	}
+
+	notes_sf = tsf_load_memory(p_bytes.ptr(), (int)p_bytes.size());
+	if (!notes_sf) {
+		UtilityFunctions::push_error("MidiPlayer: notes tsf_load_memory() failed.");
+		return false;
+	}
+
+	sample_rate = (int)AudioServer::get_singleton()->get_mix_rate();
+	if (sample_rate <= 0) {
+		sample_rate = 44100;
 	}
 
+	_configure_synth(notes_sf);
 	return true;
 }
 
 bool MidiPlayer::_load_midi_bytes(const PackedByteArray &p_bytes) {
+	MidiTraceScope trace("MidiPlayer::load_midi");
 	if (p_bytes.is_empty()) {
 		UtilityFunctions::push_error("MidiPlayer: MIDI bytes are empty.");
 		return false;
 	}
 
+	cancel_queued_midi();
+	loop_cache_epoch++;
 	if (midi) {
 		tml_free(midi);
 		midi = nullptr;
 	}
+	note_index.clear();
+	event_table.clear();
+	tempo_map.clear();
+	smf_stream.close();
+	stream_bytes = PackedByteArray();
+	streaming = false;
+	midi_length_ms = 0;
+
+	if (stream_threshold_kb > 0 && p_bytes.size() >= (int64_t)stream_threshold_kb * 1024) {
+		// Only the header and track table are read here; events are decoded during playback.
+		stream_bytes = p_bytes;
+		if (!smf_stream.open(stream_bytes.ptr(), (size_t)stream_bytes.size())) {
+			stream_bytes = PackedByteArray();
+			UtilityFunctions::push_error("MidiPlayer: Not a Standard MIDI File.");
+			return false;
+		}
+		streaming = true;
+		_prefetch_stream();
+		return true;
+	}
 
 	midi = tml_load_memory(p_bytes.ptr(), (int)p_bytes.size());
 	if (!midi) {
@@ -417,6 +1319,10 @@ bool MidiPlayer::_load_midi_bytes(const PackedByteArray &p_bytes) {
 		return false;
 	}
 
+	note_index.build(midi);
+	_build_event_table(midi, event_table);
+	tempo_map.build(midi);
+
 	unsigned int first_note_ms = 0;
 	unsigned int length_ms = 0;
 	tml_get_info(midi, nullptr, nullptr, nullptr, &first_note_ms, &length_ms);
@@ -435,13 +1341,164 @@ bool MidiPlayer::load_midi(const String &p_path) {
 	return _load_midi_bytes(bytes);
 }
 
+Node *MidiPlayer::_create_output_node() {
+	return memnew(AudioStreamPlayer);
+}
+
+bool MidiPlayer::is_culled() const {
+	return culled;
+}
+
+bool MidiPlayer::is_idle() const {
+	return idle;
+}
+
+void MidiPlayer::_wake() {
+	idle_pending_sec = 0.0;
+	if (!idle) {
+		return;
+	}
+	idle = false;
+	set_process(true);
+	// The listener may have moved while the player slept.
+	_update_spatial();
+}
+
+void MidiPlayer::_release_audio_outputs() {
+	_leave_effect_buses();
+	if (player.is_valid()) {
+		player.stop();
+	}
+	if (notes_player.is_valid()) {
+		notes_player.stop();
+	}
+	playback_base.unref();
+	playback = nullptr;
+	notes_playback_base.unref();
+	notes_playback = nullptr;
+	_stop_stem_outputs();
+}
+
+void MidiPlayer::_update_idle(double p_delta) {
+	if (playing && !paused) {
+		idle_pending_sec = 0.0;
+		return;
+	}
+	// Inaudible release tails would otherwise keep the player rendering for seconds.
+	if (sf) {
+		tsfx_kill_quiet_released_voices(sf, k_silent_tail_gain);
+	}
+	if (notes_sf) {
+		tsfx_kill_quiet_released_voices(notes_sf, k_silent_tail_gain);
+	}
+	if (_get_active_voice_count() > 0) {
+		idle_pending_sec = 0.0;
+		return;
+	}
+	// Let the generators play out what is already buffered before leaving the mix.
+	idle_pending_sec += p_delta;
+	if (idle_pending_sec < (double)generator_buffer_length) {
+		return;
+	}
+	_release_audio_outputs();
+	playback_skips = -1;
+	notes_playback_skips = -1;
+	buffer_primed = false;
+	perf_stats.event_backlog = 0;
+	perf_stats.render_usec_per_block = 0.0;
+	idle = true;
+	set_process(false);
+}
+
+void MidiPlayer::_update_distance_lod(float p_distance, float p_lod_start, float p_audible) {
+	if (p_audible <= 0.0f) {
+		lod_voice_cap = 0;
+		lod_interpolation_drop = 0;
+		if (culled) {
+			_set_culled(false);
+		}
+		return;
+	}
+
+	// A little hysteresis so a listener standing on the boundary doesn't toggle every frame.
+	const bool should_cull = culled ? p_distance > p_audible * 0.95f : p_distance > p_audible;
+	if (should_cull != culled) {
+		_set_culled(should_cull);
+	}
+	if (culled || p_distance <= p_lod_start || p_audible <= p_lod_start) {
+		lod_voice_cap = 0;
+		lod_interpolation_drop = 0;
+		return;
+	}
+
+	const float t = std::min(1.0f, (p_distance - p_lod_start) / (p_audible - p_lod_start));
+	const int min_voices = std::min(max_voices, std::max(4, max_voices / 8));
+	lod_voice_cap = std::max(min_voices, (int)((float)max_voices + (float)(min_voices - max_voices) * t));
+	lod_interpolation_drop = t > 0.5f ? 1 : 0;
+}
+
+void MidiPlayer::_set_culled(bool p_culled) {
+	culled = p_culled;
+	if (culled) {
+		// Nothing is audible: free every voice and leave the audio mix.
+		_cancel_loop_cache_pass();
+		if (sf) {
+			tsfx_kill_all_voices(sf);
+		}
+		if (notes_sf) {
+			tsfx_kill_all_voices(notes_sf);
+		}
+		_release_audio_outputs();
+	} else if (playing && !paused) {
+		_ensure_audio_setup();
+		_retrigger_held_notes(0xFFFF);
+	}
+}
+
+void MidiPlayer::_advance_culled(double p_delta) {
+	// Keep the sequence moving in real time so programs, controllers and pitch
+	// bends are correct when rendering resumes; notes are not started.
+	synth_time_sec += p_delta;
+	const uint32_t now_ms = (uint32_t)(synth_time_sec * 1000.0 * midi_speed);
+	if (queued_midi && !queued_switch_done && now_ms >= queued_switch_ms) {
+		// Events on the switch point itself belong to the new sequence.
+		if (queued_switch_ms > 0) {
+			_process_events_until_ms(queued_switch_ms - 1, true);
+		}
+		_switch_to_queued_midi();
+		_finish_midi_switch();
+	}
+	_process_events_until_ms((uint32_t)(synth_time_sec * 1000.0 * midi_speed), true);
+
+	if (_is_sequence_finished()) {
+		if (loop) {
+			_reset_synth();
+			_rewind_sequence();
+			synth_time_sec = 0.0;
+		} else {
+			stop();
+		}
+	}
+}
+
 void MidiPlayer::_ensure_audio_setup() {
-	if (!player) {
-		player = memnew(AudioStreamPlayer);
-		player->set_name("_MidiPlayerAudio");
-		add_child(player);
+	if (playback && player.is_playing()) {
+		bool stems_ready = true;
+		for (const StemOutput &stem : stems) {
+			stems_ready = stems_ready && stem.playback;
+		}
+		if (stems_ready) {
+			return;
+		}
+	}
+
+	if (!player.is_valid()) {
+		Node *node = _create_output_node();
+		node->set_name("_MidiPlayerAudio");
+		add_child(node);
+		player = MidiAudioOutput(node);
 		// Set bus after adding to tree to ensure it takes effect
-		player->set_bus(audio_bus);
+		player.set_bus(audio_bus);
 	}
 
 	sample_rate = (int)AudioServer::get_singleton()->get_mix_rate();
@@ -453,28 +1510,69 @@ void MidiPlayer::_ensure_audio_setup() {
 		generator.instantiate();
 		generator->set_mix_rate(sample_rate);
 		generator->set_buffer_length(generator_buffer_length);
-		player->set_stream(generator);
+		player.set_stream(generator);
 	}
 
-	if (!player->is_playing()) {
-		player->play();
+	if (!player.is_playing()) {
+		player.play();
 	}
 
-	playback_base = player->get_stream_playback();
+	playback_base = player.get_stream_playback();
 	playback = Object::cast_to<AudioStreamGeneratorPlayback>(playback_base.ptr());
 	if (!playback) {
 		// If this ever happens, we can't output audio.
 		UtilityFunctions::push_warning("MidiPlayer: AudioStreamGeneratorPlayback not available yet.");
 	}
+
+	_ensure_stem_outputs();
+}
+
+void MidiPlayer::_ensure_stem_outputs() {
+	for (int i = 0; i < (int)stems.size(); i++) {
+		StemOutput &stem = stems[i];
+		if (!stem.output.is_valid()) {
+			Node *node = _create_output_node();
+			node->set_name(String("_MidiPlayerStem") + String::num_int64(i + 1));
+			add_child(node);
+			stem.output = MidiAudioOutput(node);
+			stem.output.set_bus(stem.bus);
+		}
+		if (!stem.generator.is_valid()) {
+			stem.generator.instantiate();
+			stem.generator->set_mix_rate(sample_rate);
+			stem.generator->set_buffer_length(generator_buffer_length);
+			stem.output.set_stream(stem.generator);
+		}
+		if (!stem.output.is_playing()) {
+			stem.output.play();
+		}
+		stem.playback_base = stem.output.get_stream_playback();
+		stem.playback = Object::cast_to<AudioStreamGeneratorPlayback>(stem.playback_base.ptr());
+	}
+}
+
+void MidiPlayer::_stop_stem_outputs() {
+	for (StemOutput &stem : stems) {
+		if (stem.output.is_valid()) {
+			stem.output.stop();
+		}
+		stem.playback_base.unref();
+		stem.playback = nullptr;
+	}
 }
 
 void MidiPlayer::_ensure_notes_audio_setup() {
-	if (!notes_player) {
-		notes_player = memnew(AudioStreamPlayer);
-		notes_player->set_name("_MidiPlayerNotesAudio");
-		add_child(notes_player);
+	if (notes_playback && notes_player.is_playing()) {
+		return;
+	}
+
+	if (!notes_player.is_valid()) {
+		Node *node = _create_output_node();
+		node->set_name("_MidiPlayerNotesAudio");
+		add_child(node);
+		notes_player = MidiAudioOutput(node);
 		// Set bus after adding to tree
-		notes_player->set_bus(use_separate_notes_bus ? notes_audio_bus : audio_bus);
+		notes_player.set_bus(use_separate_notes_bus ? notes_audio_bus : audio_bus);
 	}
 
 	sample_rate = (int)AudioServer::get_singleton()->get_mix_rate();
@@ -486,14 +1584,14 @@ void MidiPlayer::_ensure_notes_audio_setup() {
 		notes_generator.instantiate();
 		notes_generator->set_mix_rate(sample_rate);
 		notes_generator->set_buffer_length(generator_buffer_length);
-		notes_player->set_stream(notes_generator);
+		notes_player.set_stream(notes_generator);
 	}
 
-	if (!notes_player->is_playing()) {
-		notes_player->play();
+	if (!notes_player.is_playing()) {
+		notes_player.play();
 	}
 
-	notes_playback_base = notes_player->get_stream_playback();
+	notes_playback_base = notes_player.get_stream_playback();
 	notes_playback = Object::cast_to<AudioStreamGeneratorPlayback>(notes_playback_base.ptr());
 	if (!notes_playback) {
 		UtilityFunctions::push_warning("MidiPlayer: Notes AudioStreamGeneratorPlayback not available yet.");
@@ -504,24 +1602,28 @@ void MidiPlayer::_clear_audio_buffer() {
 	if (!playback) {
 		return;
 	}
+	buffer_primed = false;
 	// There is no explicit clear API; pushing nothing lets it drain.
 	// We force a stop/play cycle to effectively reset the buffer.
-	if (player) {
-		player->stop();
-		player->play();
-		playback_base = player->get_stream_playback();
+	if (player.is_valid()) {
+		player.stop();
+		player.play();
+		playback_base = player.get_stream_playback();
 		playback = Object::cast_to<AudioStreamGeneratorPlayback>(playback_base.ptr());
 	}
+	// Stems restart together with the main output so they stay aligned.
+	_stop_stem_outputs();
+	_ensure_stem_outputs();
 }
 
 void MidiPlayer::_clear_notes_audio_buffer() {
 	if (!notes_playback) {
 		return;
 	}
-	if (notes_player) {
-		notes_player->stop();
-		notes_player->play();
-		notes_playback_base = notes_player->get_stream_playback();
+	if (notes_player.is_valid()) {
+		notes_player.stop();
+		notes_player.play();
+		notes_playback_base = notes_player.get_stream_playback();
 		notes_playback = Object::cast_to<AudioStreamGeneratorPlayback>(notes_playback_base.ptr());
 	}
 }
@@ -531,14 +1633,13 @@ void MidiPlayer::_reset_synth() {
 		return;
 	}
 	tsf_reset(sf);
-	// Re-apply volume since reset may clear channels.
-	tsf_set_output(sf, TSF_STEREO_INTERLEAVED, sample_rate, 0.0f);
-	tsf_set_max_voices(sf, 256);
-	tsf_set_volume(sf, volume);
-	for (int ch = 0; ch < 16; ch++) {
-		tsf_channel_set_presetnumber(sf, ch, 0, ch == 9);
-		tsf_channel_midi_control(sf, ch, (int)TML_PAN_MSB, 64);
-		tsf_channel_midi_control(sf, ch, (int)TML_VOLUME_MSB, 127);
+	// Re-apply output settings since reset may clear channels.
+	_configure_synth(sf);
+	dispatcher.clear_held_notes();
+	dispatcher.reset_effect_sends();
+	upsampler.reset();
+	for (StemOutput &stem : stems) {
+		stem.upsampler.reset();
 	}
 }
 
@@ -547,14 +1648,8 @@ void MidiPlayer::_reset_notes_synth() {
 		return;
 	}
 	tsf_reset(notes_sf);
-	tsf_set_output(notes_sf, TSF_STEREO_INTERLEAVED, sample_rate, 0.0f);
-	tsf_set_max_voices(notes_sf, 256);
-	tsf_set_volume(notes_sf, volume);
-	for (int ch = 0; ch < 16; ch++) {
-		tsf_channel_set_presetnumber(notes_sf, ch, 0, ch == 9);
-		tsf_channel_midi_control(notes_sf, ch, (int)TML_PAN_MSB, 64);
-		tsf_channel_midi_control(notes_sf, ch, (int)TML_VOLUME_MSB, 127);
-	}
+	_configure_synth(notes_sf);
+	notes_upsampler.reset();
 }
 
 void MidiPlayer::play() {
@@ -565,13 +1660,13 @@ void MidiPlayer::play() {
 			_load_soundfont_bytes(soundfont_resource->get_data());
 		}
 	}
-	if (!midi) {
+	if (!_has_sequence()) {
 		if (midi_resource.is_valid() && !midi_resource->get_data().is_empty()) {
 			_load_midi_bytes(midi_resource->get_data());
 		}
 	}
 
-	if (!sf || !midi) {
+	if (!sf || !_has_sequence()) {
 		UtilityFunctions::push_error("MidiPlayer: Cannot play (missing soundfont or midi). Call load_soundfont() and load_midi() first.");
 		return;
 	}
@@ -579,22 +1674,26 @@ void MidiPlayer::play() {
 	_reset_synth();
 	_clear_audio_buffer();
 
-	event_cursor = midi;
+	_rewind_sequence();
 	synth_time_sec = 0.0;
+	_begin_loop_cache_pass();
 	playing = true;
 	paused = false;
+	_wake();
 
-	if (player && !player->is_playing()) {
-		player->play();
+	if (player.is_valid() && !player.is_playing()) {
+		player.play();
 	}
 }
 
 void MidiPlayer::stop() {
+	cancel_queued_midi();
+	_cancel_loop_cache_pass();
 	playing = false;
 	paused = false;
 	synth_time_sec = 0.0;
 	notes_time_sec = 0.0;
-	event_cursor = midi;
+	_rewind_sequence();
 
 	if (sf) {
 		tsf_note_off_all(sf);
@@ -604,16 +1703,144 @@ void MidiPlayer::stop() {
 		tsf_note_off_all(notes_sf);
 		tsf_reset(notes_sf);
 	}
-	if (player) {
-		player->stop();
+	if (player.is_valid()) {
+		player.stop();
 	}
-	if (notes_player) {
-		notes_player->stop();
+	if (notes_player.is_valid()) {
+		notes_player.stop();
 	}
 	playback_base.unref();
 	playback = nullptr;
 	notes_playback_base.unref();
 	notes_playback = nullptr;
+	_stop_stem_outputs();
+}
+
+void MidiPlayer::queue_midi(const Ref<MidiFileResource> &p_resource, const Variant &p_at) {
+	if (p_resource.is_null() || p_resource->get_data().is_empty()) {
+		UtilityFunctions::push_error("MidiPlayer: queue_midi() needs a MIDI resource with data.");
+		return;
+	}
+	if (sequence.is_valid()) {
+		UtilityFunctions::push_error("MidiPlayer: queue_midi() is not available while a MidiSequence is set.");
+		return;
+	}
+	if (!playing || !_has_sequence() || !sf) {
+		// Nothing to align to: start right away.
+		set_midi(p_resource);
+		play();
+		return;
+	}
+
+	const double now_ms = synth_time_sec * 1000.0 * midi_speed;
+	double switch_ms = now_ms;
+	if (p_at.get_type() == Variant::STRING || p_at.get_type() == Variant::STRING_NAME) {
+		const String at = p_at;
+		if (at == "next_bar") {
+			switch_ms = tempo_map.get_next_boundary_ms(now_ms, beats_per_bar);
+		} else if (at == "next_beat") {
+			switch_ms = tempo_map.get_next_boundary_ms(now_ms, 1);
+		} else {
+			UtilityFunctions::push_error("MidiPlayer: queue_midi() 'at' must be \"next_bar\", \"next_beat\" or a time in seconds.");
+			return;
+		}
+	} else if (p_at.get_type() == Variant::FLOAT || p_at.get_type() == Variant::INT) {
+		switch_ms = std::max(now_ms, (double)p_at * 1000.0);
+	} else {
+		UtilityFunctions::push_error("MidiPlayer: queue_midi() 'at' must be \"next_bar\", \"next_beat\" or a time in seconds.");
+		return;
+	}
+	// A switch point past the end of the song happens when it ends instead.
+	if (!streaming || smf_stream.is_fully_decoded()) {
+		switch_ms = std::min(switch_ms, (double)midi_length_ms);
+	}
+
+	const PackedByteArray bytes = p_resource->get_data();
+	MidiTraceScope trace("MidiPlayer::queue_midi parse");
+	tml_message *parsed = tml_load_memory(bytes.ptr(), (int)bytes.size());
+	if (!parsed) {
+		UtilityFunctions::push_error("MidiPlayer: tml_load_memory() failed for the queued MIDI.");
+		return;
+	}
+
+	cancel_queued_midi();
+	queued_midi = parsed;
+	queued_resource = p_resource;
+	queued_note_index.build(queued_midi);
+	_build_event_table(queued_midi, queued_event_table);
+	queued_tempo_map.build(queued_midi);
+	unsigned int first_note_ms = 0;
+	unsigned int length_ms = 0;
+	tml_get_info(queued_midi, nullptr, nullptr, nullptr, &first_note_ms, &length_ms);
+	queued_length_ms = (uint32_t)length_ms;
+	queued_switch_ms = (uint32_t)std::ceil(switch_ms);
+}
+
+void MidiPlayer::cancel_queued_midi() {
+	if (queued_midi) {
+		tml_free(queued_midi);
+		queued_midi = nullptr;
+	}
+	queued_resource.unref();
+	queued_note_index.clear();
+	queued_event_table.clear();
+	queued_tempo_map.clear();
+	queued_length_ms = 0;
+	queued_switch_done = false;
+}
+
+bool MidiPlayer::has_queued_midi() const {
+	return queued_midi && !queued_switch_done;
+}
+
+void MidiPlayer::set_beats_per_bar(int p_beats) {
+	beats_per_bar = std::max(1, p_beats);
+}
+
+int MidiPlayer::get_beats_per_bar() const {
+	return beats_per_bar;
+}
+
+void MidiPlayer::_switch_to_queued_midi() {
+	// Runs inside the render scope: only swaps, nothing is allocated or freed here.
+	for (int ch = 0; ch < 16; ch++) {
+		// The old sequence's note-offs will never arrive, so release everything it holds.
+		tsf_channel_midi_control(sf, ch, (int)TML_SUSTAIN_SWITCH, 0);
+		tsf_channel_note_off_all(sf, ch);
+		// Nor should its programs, controllers and bends color the new one: start
+		// from the same channel defaults as _configure_synth().
+		tsf_channel_midi_control(sf, ch, (int)TML_ALL_CTRL_OFF, 0);
+		tsf_channel_set_pitchwheel(sf, ch, 8192);
+		tsf_channel_set_presetnumber(sf, ch, 0, ch == 9);
+	}
+	dispatcher.clear_held_notes();
+
+	// The new sequence's time 0 is the switch point.
+	synth_time_sec -= (double)queued_switch_ms / (1000.0 * midi_speed);
+	std::swap(midi, queued_midi);
+	std::swap(note_index, queued_note_index);
+	std::swap(event_table, queued_event_table);
+	std::swap(tempo_map, queued_tempo_map);
+	std::swap(midi_length_ms, queued_length_ms);
+	event_cursor = midi;
+	loop_cache_epoch++;
+	// A streamed sequence is retired as a whole; its data is released in _finish_midi_switch().
+	streaming = false;
+	queued_switch_done = true;
+}
+
+void MidiPlayer::_finish_midi_switch() {
+	if (!queued_switch_done) {
+		return;
+	}
+	// The queued slots now hold the retired sequence.
+	midi_resource = queued_resource;
+	cancel_queued_midi();
+	if (!streaming && smf_stream.is_open()) {
+		smf_stream.close();
+		stream_bytes = PackedByteArray();
+	}
+	emit_signal("queued_midi_started");
 }
 
 void MidiPlayer::pause() {
@@ -621,9 +1848,10 @@ void MidiPlayer::pause() {
 		return;
 	}
 	paused = true;
-	if (player) {
-		player->stop();
+	if (player.is_valid()) {
+		player.stop();
 	}
+	_stop_stem_outputs();
 }
 
 void MidiPlayer::resume() {
@@ -631,9 +1859,10 @@ void MidiPlayer::resume() {
 		return;
 	}
 	paused = false;
+	_wake();
 	_ensure_audio_setup();
-	if (player && !player->is_playing()) {
-		player->play();
+	if (player.is_valid() && !player.is_playing()) {
+		player.play();
 	}
 }
 
@@ -642,6 +1871,9 @@ bool MidiPlayer::is_playing() const {
 }
 
 float MidiPlayer::get_length_seconds() const {
+	if (sequence.is_valid()) {
+		return (float)sequence->get_length_seconds();
+	}
 	return (float)midi_length_ms / 1000.0f;
 }
 
@@ -649,99 +1881,673 @@ float MidiPlayer::get_playback_position_seconds() const {
 	return (float)synth_time_sec;
 }
 
-void MidiPlayer::_apply_event(const tml_message *p_msg) {
-	if (!sf || !p_msg) {
-		return;
-	}
-
-	switch (p_msg->type) {
-		case TML_NOTE_ON: {
-			const float vel = (float)(uint8_t)p_msg->velocity / 127.0f;
-			tsf_channel_note_on(sf, p_msg->channel, p_msg->key, vel);
-		} break;
-		case TML_NOTE_OFF: {
-			tsf_channel_note_off(sf, p_msg->channel, p_msg->key);
-		} break;
-		case TML_CONTROL_CHANGE: {
-			tsf_channel_midi_control(sf, p_msg->channel, (int)(uint8_t)p_msg->control, (int)(uint8_t)p_msg->control_value);
-		} break;
-		case TML_PROGRAM_CHANGE: {
-			tsf_channel_set_presetnumber(sf, p_msg->channel, (int)(uint8_t)p_msg->program, p_msg->channel == 9);
-		} break;
-		case TML_PITCH_BEND: {
-			tsf_channel_set_pitchwheel(sf, p_msg->channel, (int)p_msg->pitch_bend);
-		} break;
-		case TML_CHANNEL_PRESSURE:
-		case TML_KEY_PRESSURE:
-			// Not directly supported by TSF channel API.
-			break;
-		default:
-			// Includes tempo meta messages and EOT. Times are already baked into Msg->time.
-			break;
+Dictionary MidiPlayer::get_notes_in_range(float p_from_sec, float p_to_sec, int p_channel_mask) const {
+	PackedFloat32Array times;
+	PackedFloat32Array durations;
+	PackedInt32Array keys;
+	PackedInt32Array velocities;
+	PackedInt32Array channels;
+
+	if (p_to_sec > p_from_sec && !note_index.is_empty()) {
+		const uint32_t from_ms = (uint32_t)(std::max(0.0f, p_from_sec) * 1000.0f);
+		const uint32_t to_ms = (uint32_t)(std::max(0.0f, p_to_sec) * 1000.0f);
+		size_t begin = 0;
+		size_t end = 0;
+		note_index.find_range(from_ms, to_ms, begin, end);
+
+		int count = 0;
+		for (size_t i = begin; i < end; i++) {
+			if (p_channel_mask & (1 << note_index[i].channel)) {
+				count++;
+			}
+		}
+
+		times.resize(count);
+		durations.resize(count);
+		keys.resize(count);
+		velocities.resize(count);
+		channels.resize(count);
+		float *times_w = times.ptrw();
+		float *durations_w = durations.ptrw();
+		int32_t *keys_w = keys.ptrw();
+		int32_t *velocities_w = velocities.ptrw();
+		int32_t *channels_w = channels.ptrw();
+
+		int out = 0;
+		for (size_t i = begin; i < end; i++) {
+			const MidiNoteSpan &span = note_index[i];
+			if (!(p_channel_mask & (1 << span.channel))) {
+				continue;
+			}
+			times_w[out] = (float)span.time_ms / 1000.0f;
+			durations_w[out] = (float)span.duration_ms / 1000.0f;
+			keys_w[out] = span.key;
+			velocities_w[out] = span.velocity;
+			channels_w[out] = span.channel;
+			out++;
+		}
 	}
+
+	Dictionary result;
+	result["time"] = times;
+	result["duration"] = durations;
+	result["key"] = keys;
+	result["velocity"] = velocities;
+	result["channel"] = channels;
+	return result;
 }
 
-void MidiPlayer::_process_events_until_ms(uint32_t p_time_ms) {
-	while (event_cursor && event_cursor->time <= p_time_ms) {
-		_apply_event(event_cursor);
-		event_cursor = event_cursor->next;
+int MidiPlayer::get_note_count() const {
+	return (int)note_index.size();
+}
 
-		if (!event_cursor) {
-			break;
+// Layout of a capture_state() block: this header, held notes as (channel, key, velocity)
+// triples, then the tsfx_state_save() blocks of the sequence synth and the notes synth.
+struct MidiPlayerStateHeader {
+	uint32_t magic;
+	uint32_t flags;
+	double synth_time_sec;
+	double notes_time_sec;
+	int32_t event_index; // -1: every event was dispatched
+	int32_t event_count; // identifies the sequence together with length_ms
+	uint32_t length_ms;
+	int32_t held_count;
+	int32_t synth_bytes;
+	int32_t notes_synth_bytes;
+	uint8_t reverb_sends[16];
+	uint8_t chorus_sends[16];
+};
+
+static constexpr uint32_t k_state_magic = 0x3153504D; // "MPS1"
+static constexpr uint32_t k_state_playing = 1;
+static constexpr uint32_t k_state_paused = 2;
+
+void MidiPlayer::_build_event_table(const tml_message *p_first, std::vector<const tml_message *> &r_table) {
+	r_table.clear();
+	for (const tml_message *msg = p_first; msg; msg = msg->next) {
+		r_table.push_back(msg);
+	}
+}
+
+int MidiPlayer::_get_event_index(const tml_message *p_message) const {
+	if (!p_message) {
+		return -1;
+	}
+	// Messages are in time order: binary search to the message's time, then step over its neighbours.
+	auto it = std::lower_bound(event_table.begin(), event_table.end(), p_message->time,
+			[](const tml_message *p_msg, unsigned int p_time) { return p_msg->time < p_time; });
+	for (; it != event_table.end() && (*it)->time == p_message->time; ++it) {
+		if (*it == p_message) {
+			return (int)(it - event_table.begin());
 		}
 	}
+	return -1;
 }
 
-void MidiPlayer::_pump_audio(bool p_process_events) {
-	if (!sf || !playback) {
+PackedByteArray MidiPlayer::capture_state() const {
+	PackedByteArray state;
+	if (streaming || sequence.is_valid()) {
+		UtilityFunctions::push_error("MidiPlayer: capture_state() supports MIDI files only, not streamed files (see stream_threshold_kb) or a MidiSequence.");
+		return state;
+	}
+	if (!sf || !midi) {
+		UtilityFunctions::push_error("MidiPlayer: capture_state() needs a loaded SoundFont and MIDI file.");
+		return state;
+	}
+
+	MidiPlayerStateHeader header;
+	header.magic = k_state_magic;
+	header.flags = (playing ? k_state_playing : 0) | (paused ? k_state_paused : 0);
+	header.synth_time_sec = synth_time_sec;
+	header.notes_time_sec = notes_time_sec;
+	header.event_index = _get_event_index(event_cursor);
+	header.event_count = (int32_t)event_table.size();
+	header.length_ms = midi_length_ms;
+	header.held_count = 0;
+	for (int ch = 0; ch < 16; ch++) {
+		for (int key = 0; key < 128; key++) {
+			header.held_count += dispatcher.held_velocity[ch][key] ? 1 : 0;
+		}
+	}
+	header.synth_bytes = tsfx_state_size(sf);
+	header.notes_synth_bytes = notes_sf ? tsfx_state_size(notes_sf) : 0;
+	memcpy(header.reverb_sends, dispatcher.reverb_sends, sizeof(header.reverb_sends));
+	memcpy(header.chorus_sends, dispatcher.chorus_sends, sizeof(header.chorus_sends));
+
+	state.resize((int64_t)sizeof(header) + header.held_count * 3 + header.synth_bytes + header.notes_synth_bytes);
+	uint8_t *out = state.ptrw();
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	for (int ch = 0; ch < 16; ch++) {
+		for (int key = 0; key < 128; key++) {
+			if (dispatcher.held_velocity[ch][key]) {
+				*out++ = (uint8_t)ch;
+				*out++ = (uint8_t)key;
+				*out++ = dispatcher.held_velocity[ch][key];
+			}
+		}
+	}
+	out += tsfx_state_save(sf, out, header.synth_bytes);
+	if (notes_sf) {
+		tsfx_state_save(notes_sf, out, header.notes_synth_bytes);
+	}
+	return state;
+}
+
+bool MidiPlayer::restore_state(const PackedByteArray &p_state, bool p_flush_audio) {
+	MidiPlayerStateHeader header;
+	if (p_state.size() < (int64_t)sizeof(header)) {
+		UtilityFunctions::push_error("MidiPlayer: restore_state(): not a MidiPlayer state.");
+		return false;
+	}
+	const uint8_t *in = p_state.ptr();
+	memcpy(&header, in, sizeof(header));
+	if (header.magic != k_state_magic || header.held_count < 0 || header.synth_bytes < 0 || header.notes_synth_bytes < 0 ||
+			p_state.size() != (int64_t)sizeof(header) + (int64_t)header.held_count * 3 + header.synth_bytes + header.notes_synth_bytes) {
+		UtilityFunctions::push_error("MidiPlayer: restore_state(): not a MidiPlayer state.");
+		return false;
+	}
+	if (!sf || !midi || streaming || sequence.is_valid()) {
+		UtilityFunctions::push_error("MidiPlayer: restore_state() needs the SoundFont and (non-streamed) MIDI file the state was captured with.");
+		return false;
+	}
+	if (header.event_count != (int32_t)event_table.size() || header.length_ms != midi_length_ms || header.event_index >= header.event_count) {
+		UtilityFunctions::push_error("MidiPlayer: restore_state(): the state was captured with a different MIDI file.");
+		return false;
+	}
+	in += sizeof(header);
+	const uint8_t *held = in;
+	in += header.held_count * 3;
+	const uint8_t *synth_state = in;
+	const uint8_t *notes_synth_state = in + header.synth_bytes;
+	// Both blocks are checked before either synth is overwritten, so a rejected state changes nothing.
+	if (!tsfx_state_check(sf, synth_state, header.synth_bytes)) {
+		UtilityFunctions::push_error("MidiPlayer: restore_state(): the state was captured with a different SoundFont.");
+		return false;
+	}
+	if (header.notes_synth_bytes > 0 && (!notes_sf || !tsfx_state_check(notes_sf, notes_synth_state, header.notes_synth_bytes))) {
+		UtilityFunctions::push_error("MidiPlayer: restore_state(): the state has a notes synth this player lacks or loaded with a different SoundFont.");
+		return false;
+	}
+	if (!tsfx_state_load(sf, synth_state, header.synth_bytes) ||
+			(header.notes_synth_bytes > 0 && !tsfx_state_load(notes_sf, notes_synth_state, header.notes_synth_bytes))) {
+		UtilityFunctions::push_error("MidiPlayer: restore_state(): out of memory while restoring the synth state.");
+		return false;
+	}
+
+	cancel_queued_midi();
+	// The restored voices replace whatever a cached pass would have played.
+	_cancel_loop_cache_pass();
+	loop_cache_epoch++;
+	dispatcher.clear_held_notes();
+	for (int i = 0; i < header.held_count; i++) {
+		dispatcher.held_velocity[held[i * 3] & 0x0F][held[i * 3 + 1] & 0x7F] = held[i * 3 + 2];
+	}
+	memcpy(dispatcher.reverb_sends, header.reverb_sends, sizeof(header.reverb_sends));
+	memcpy(dispatcher.chorus_sends, header.chorus_sends, sizeof(header.chorus_sends));
+	event_cursor = header.event_index >= 0 ? event_table[header.event_index] : nullptr;
+	synth_time_sec = header.synth_time_sec;
+	notes_time_sec = header.notes_time_sec;
+	playing = (header.flags & k_state_playing) != 0;
+	paused = false;
+
+	upsampler.reset();
+	notes_upsampler.reset();
+	for (StemOutput &stem : stems) {
+		stem.upsampler.reset();
+	}
+	_wake();
+	if (playing) {
+		_ensure_audio_setup();
+		if (p_flush_audio) {
+			// Otherwise up to a buffer of audio rendered from the old state plays first.
+			_clear_audio_buffer();
+		} else if (player.is_valid() && !player.is_playing()) {
+			player.play();
+		}
+		if (header.flags & k_state_paused) {
+			pause();
+		}
+	}
+	return true;
+}
+
+void MidiPlayer::_process_events_until_ms(uint32_t p_time_ms, bool p_silent) {
+	MidiTraceScope trace("MidiPlayer::_process_events_until_ms");
+	const uint64_t events_before = dispatcher.events_dispatched;
+	dispatcher.voice_cap = _get_effective_max_voices();
+	if (sequence.is_valid()) {
+		const MidiEventList &events = sequence->get_events();
+		if (events.get_generation() != sequence_generation) {
+			// clear() freed the messages; whatever is appended next starts from the top.
+			sequence_generation = events.get_generation();
+			sequence_last = nullptr;
+		}
+		sequence_last = dispatcher.process_after(sf, events.first(), sequence_last, p_time_ms, p_silent);
+	} else if (streaming) {
+		dispatcher.process_until(sf, smf_stream, p_time_ms, p_silent);
+	} else {
+		event_cursor = dispatcher.process_until(sf, event_cursor, p_time_ms, p_silent);
+	}
+	if (trace.is_active()) {
+		trace.events = (int64_t)(dispatcher.events_dispatched - events_before);
+	}
+}
+
+bool MidiPlayer::_has_sequence() const {
+	return midi || streaming || sequence.is_valid();
+}
+
+bool MidiPlayer::_is_sequence_finished() const {
+	if (sequence.is_valid()) {
+		if (!sequence->is_complete()) {
+			return false;
+		}
+		const MidiEventList &events = sequence->get_events();
+		const tml_message *last = events.get_generation() == sequence_generation ? sequence_last : nullptr;
+		return !(last ? last->next : events.first());
+	}
+	return streaming ? smf_stream.is_finished() : !event_cursor;
+}
+
+void MidiPlayer::_rewind_sequence() {
+	event_cursor = midi;
+	sequence_last = nullptr;
+	if (sequence.is_valid()) {
+		sequence_generation = sequence->get_events().get_generation();
+	}
+	if (streaming) {
+		// The beat grid is rebuilt from the tempo events as they are decoded again.
+		smf_stream.rewind();
+		tempo_map.clear();
+		_prefetch_stream();
+	}
+}
+
+void MidiPlayer::_prefetch_stream() {
+	if (!streaming) {
 		return;
 	}
+	// Outside the render scope: the ring is refilled here so the pump rarely decodes,
+	// and the tempo map may allocate.
+	smf_stream.prefetch();
+	uint32_t tempo_ms = 0;
+	int usec_per_beat = 0;
+	while (smf_stream.pop_tempo_change(tempo_ms, usec_per_beat)) {
+		tempo_map.add_tempo((double)tempo_ms, usec_per_beat);
+	}
+	midi_length_ms = smf_stream.get_decoded_ms();
+}
 
-	int frames_available = playback->get_frames_available();
-	if (frames_available <= 0) {
+static void mix_loop_cache_key(uint64_t &r_hash, uint64_t p_value) {
+	// FNV-1a, one value at a time.
+	r_hash = (r_hash ^ p_value) * 1099511628211ull;
+}
+
+static uint64_t float_key_bits(float p_value) {
+	uint32_t bits;
+	memcpy(&bits, &p_value, sizeof(bits));
+	return bits;
+}
+
+bool MidiPlayer::_is_loop_cache_eligible() const {
+	// Stems and effect sends need more than the main output's PCM, and a sequence
+	// that is still being appended to does not repeat.
+	return loop && loop_cache_mb > 0.0f && stems.empty() && !effect_sends && (sequence.is_null() || sequence->is_complete());
+}
+
+uint64_t MidiPlayer::_get_loop_cache_key() const {
+	// Every setting the main output's PCM depends on, so an adaptive quality step
+	// also ends a recording.
+	uint64_t hash = 14695981039346656037ull;
+	mix_loop_cache_key(hash, loop_cache_epoch);
+	mix_loop_cache_key(hash, (uint64_t)quality_level);
+	mix_loop_cache_key(hash, (uint64_t)sample_rate);
+	mix_loop_cache_key(hash, float_key_bits(midi_speed));
+	mix_loop_cache_key(hash, float_key_bits(volume));
+	mix_loop_cache_key(hash, (uint64_t)max_voices);
+	mix_loop_cache_key(hash, (uint64_t)lod_voice_cap);
+	mix_loop_cache_key(hash, (uint64_t)interpolation);
+	mix_loop_cache_key(hash, (uint64_t)lod_interpolation_drop);
+	mix_loop_cache_key(hash, (uint64_t)synthesis_rate_divisor);
+	mix_loop_cache_key(hash, (uint64_t)dispatcher.steal_policy);
+	mix_loop_cache_key(hash, ((uint64_t)stems.size() << 1) | (effect_sends ? 1 : 0));
+	mix_loop_cache_key(hash, ((uint64_t)dispatcher.muted_channels << 16) | dispatcher.solo_channels);
+	for (int ch = 0; ch < 16; ch++) {
+		mix_loop_cache_key(hash, ((uint64_t)(uint32_t)dispatcher.channel_voice_limits[ch] << 32) | (uint32_t)dispatcher.channel_priorities[ch]);
+	}
+	if (sequence.is_valid()) {
+		mix_loop_cache_key(hash, ((uint64_t)sequence->get_events().get_generation() << 32) | (uint32_t)sequence->get_event_count());
+	}
+	return hash;
+}
+
+void MidiPlayer::_begin_loop_cache_pass() {
+	// Called by play() with the synth reset and the sequence rewound.
+	loop_cache_replaying = false;
+	loop_cache_fade = nullptr;
+	if (!_is_loop_cache_eligible()) {
+		_cancel_loop_cache_pass();
+		return;
+	}
+	const uint64_t key = _get_loop_cache_key();
+	if (loop_cache.can_replay(key)) {
+		loop_cache.rewind();
+		loop_cache_replaying = true;
+		return;
+	}
+	// Degraded audio is not worth keeping: replaying it would hold the quality
+	// down long after the load that caused it is gone.
+	if (quality_level > 0) {
+		_cancel_loop_cache_pass();
 		return;
 	}
+	// Room for the pass and its release tails, within the budget. A streamed file's
+	// length is not known up front.
+	int64_t max_frames = (int64_t)((double)loop_cache_mb * 1024.0 * 1024.0 / (2.0 * sizeof(float)));
+	if (!streaming) {
+		const double pass_sec = (double)get_length_seconds() / (double)midi_speed + k_loop_cache_tail_sec;
+		max_frames = std::min(max_frames, (int64_t)(pass_sec * (double)sample_rate));
+	}
+	loop_cache.begin_recording(max_frames, key);
+}
+
+void MidiPlayer::_cancel_loop_cache_pass() {
+	loop_cache_replaying = false;
+	loop_cache_fade = nullptr;
+	if (loop_cache.get_state() == MidiLoopCache::STATE_RECORDING) {
+		loop_cache.invalidate();
+	}
+}
+
+void MidiPlayer::_leave_loop_cache_replay() {
+	// The sequence kept its channel and held-note state while the recording played,
+	// so live synthesis picks up from here: held notes start sounding again and the
+	// next live block fades in over the recorded one. The next pass records anew.
+	loop_cache_replaying = false;
+	loop_cache_fade = loop_cache.read(k_block_frames);
+	loop_cache.invalidate();
+	_retrigger_held_notes(0xFFFF);
+}
 
-	std::vector<float> interleaved;
-	interleaved.resize((size_t)k_block_frames * 2);
+void MidiPlayer::_push_block(AudioStreamGeneratorPlayback *p_playback, const float *p_interleaved) {
+	MidiTraceScope trace("MidiPlayer::_push_block");
+	// push_buffer() copies into the generator's ring buffer and keeps no reference,
+	// so the same array is refilled in place every block.
+	Vector2 *frames = push_block.ptrw();
+	for (int i = 0; i < k_block_frames; i++) {
+		frames[i] = Vector2(p_interleaved[i * 2 + 0], p_interleaved[i * 2 + 1]);
+	}
+	p_playback->push_buffer(push_block);
+}
+
+void MidiPlayer::_count_underruns(AudioStreamGeneratorPlayback *p_playback, int64_t &r_last_skips) {
+	const int64_t skips = p_playback->get_skips();
+	// r_last_skips is -1 after a frame without feeding; a new playback starts from zero again.
+	if (r_last_skips >= 0 && skips > r_last_skips) {
+		perf_stats.underruns += skips - r_last_skips;
+	}
+	r_last_skips = skips;
+}
+
+void MidiPlayer::_update_performance_stats() {
+	perf_stats.render_usec_per_block = perf_render_blocks > 0 ? (double)perf_render_usec / (double)perf_render_blocks : 0.0;
+	perf_render_usec = 0;
+	perf_render_blocks = 0;
+	perf_stats.peak_voices = std::max(perf_stats.peak_voices, _get_active_voice_count());
+	perf_stats.event_backlog = (int)(dispatcher.events_dispatched - perf_events_mark);
+	perf_events_mark = dispatcher.events_dispatched;
+}
+
+int MidiPlayer::_get_active_voice_count() const {
+	int count = 0;
+	if (sf) {
+		count += tsf_active_voice_count(sf);
+	}
+	if (notes_sf) {
+		count += tsf_active_voice_count(notes_sf);
+	}
+	return count;
+}
 
-	while (frames_available > 0) {
-		const int frames = std::min(frames_available, k_block_frames);
-		const double block_end_sec = synth_time_sec + (double)frames / (double)sample_rate;
-		if (p_process_events) {
-			// Apply midi_speed to convert real time to MIDI time
-			const uint32_t block_end_ms = (uint32_t)(block_end_sec * 1000.0 * midi_speed);
-			_process_events_until_ms(block_end_ms);
+int64_t MidiPlayer::_get_sample_memory_bytes() const {
+	int64_t bytes = 0;
+	// The separate notes synth loads its own copy of the font.
+	if (sf) {
+		bytes += tsfx_font_memory_bytes(sf);
+	}
+	if (notes_sf) {
+		bytes += tsfx_font_memory_bytes(notes_sf);
+	}
+	for (const KeyValue<uint64_t, Ref<AudioStreamWAV>> &entry : note_cache) {
+		if (entry.value.is_valid()) {
+			bytes += entry.value->get_data().size();
 		}
+	}
+	return bytes;
+}
+
+Dictionary MidiPlayer::get_performance_stats() const {
+	Dictionary stats;
+	stats["render_usec_per_block"] = perf_stats.render_usec_per_block;
+	stats["active_voices"] = _get_active_voice_count();
+	stats["peak_voices"] = perf_stats.peak_voices;
+	stats["underruns"] = perf_stats.underruns;
+	stats["frames_pushed"] = perf_stats.frames_pushed;
+	stats["event_backlog"] = perf_stats.event_backlog;
+	stats["sample_memory"] = _get_sample_memory_bytes();
+	return stats;
+}
+
+void MidiPlayer::reset_performance_stats() {
+	perf_stats = PerformanceStats();
+	perf_render_usec = 0;
+	perf_render_blocks = 0;
+	perf_events_mark = dispatcher.events_dispatched;
+	// The adaptive buffer compares against the counter; a stale mark would read as new underruns.
+	buffer_underruns_seen = 0;
+}
+
+void MidiPlayer::start_trace(int p_events_per_thread) {
+	MidiTrace::start(p_events_per_thread);
+}
+
+void MidiPlayer::stop_trace() {
+	MidiTrace::stop();
+}
 
-		if ((int)interleaved.size() < frames * 2) {
-			interleaved.resize((size_t)frames * 2);
+bool MidiPlayer::is_tracing() {
+	return MidiTrace::is_enabled();
+}
+
+Error MidiPlayer::save_trace(const String &p_path) {
+	Ref<FileAccess> f = FileAccess::open(p_path, FileAccess::WRITE);
+	if (f.is_null()) {
+		UtilityFunctions::push_error(String("MidiPlayer: Failed to open trace file: ") + p_path);
+		return FileAccess::get_open_error();
+	}
+	const std::string json = MidiTrace::dump_json();
+	PackedByteArray bytes;
+	bytes.resize((int64_t)json.size());
+	memcpy(bytes.ptrw(), json.data(), json.size());
+	f->store_buffer(bytes);
+	return OK;
+}
+
+void MidiPlayer::_update_adaptive_buffer(double p_delta) {
+	if (!adaptive_buffer) {
+		return;
+	}
+	// Watch whichever generator was fed last frame.
+	AudioStreamGeneratorPlayback *watched = nullptr;
+	if (playback && playback_skips >= 0) {
+		watched = playback;
+	} else if (notes_playback && notes_playback_skips >= 0) {
+		watched = notes_playback;
+	}
+	if (!watched || !buffer_primed) {
+		buffer_calm_sec = 0.0;
+		return;
+	}
+
+	const int available = watched->get_frames_available();
+	buffer_capacity_frames = std::max(buffer_capacity_frames, available);
+	const int queued = buffer_capacity_frames - available;
+	const float target_frames = buffer_target_length * (float)sample_rate;
+	const float min_length = std::min(min_buffer_length, generator_buffer_length);
+
+	if (perf_stats.underruns != buffer_underruns_seen || (float)queued < target_frames * k_buffer_low_water) {
+		buffer_target_length = std::min(generator_buffer_length, buffer_target_length * k_buffer_grow_factor);
+		buffer_calm_sec = 0.0;
+	} else if ((float)queued >= target_frames * 0.5f) {
+		buffer_calm_sec += p_delta;
+		if (buffer_calm_sec >= k_buffer_calm_sec) {
+			buffer_target_length = std::max(min_length, buffer_target_length * k_buffer_shrink_factor);
+			buffer_calm_sec = 0.0;
 		}
+	} else {
+		buffer_calm_sec = 0.0;
+	}
+	buffer_underruns_seen = perf_stats.underruns;
+}
 
-		tsf_render_float(sf, interleaved.data(), frames, 0);
+int MidiPlayer::_limit_to_buffer_target(int p_frames_available) {
+	buffer_capacity_frames = std::max(buffer_capacity_frames, p_frames_available);
+	if (!adaptive_buffer) {
+		return p_frames_available;
+	}
+	const int queued = buffer_capacity_frames - p_frames_available;
+	const int target_frames = (int)(buffer_target_length * (float)sample_rate);
+	return std::max(0, std::min(p_frames_available, target_frames - queued));
+}
+
+void MidiPlayer::_pump_audio(bool p_process_events) {
+	if (!sf || !playback) {
+		return;
+	}
+	_count_underruns(playback, playback_skips);
 
-		PackedVector2Array buf;
-		buf.resize(frames);
-		for (int i = 0; i < frames; i++) {
-			const float l = interleaved[i * 2 + 0];
-			const float r = interleaved[i * 2 + 1];
-			buf.set(i, Vector2(l, r));
+	// Every output receives frames from the same render pass, so only fill what all of them can take.
+	int frames_available = playback->get_frames_available();
+	for (const StemOutput &stem : stems) {
+		if (stem.playback) {
+			frames_available = std::min(frames_available, stem.playback->get_frames_available());
+		}
+	}
+	frames_available = _limit_to_buffer_target(frames_available);
+	if (frames_available < k_block_frames) {
+		return;
+	}
+	buffer_primed = true;
+
+	bool restart = false;
+	{
+		MIDI_RT_SCOPE("MidiPlayer::_pump_audio");
+		MidiTraceScope trace("MidiPlayer::_pump_audio");
+		const uint64_t events_before = dispatcher.events_dispatched;
+		MidiDenormalScope denormals;
+		const int output_count = 1 + (int)stems.size();
+		float *targets[k_max_outputs];
+		for (int o = 0; o < output_count; o++) {
+			targets[o] = render_blocks.data() + (size_t)o * k_block_frames * 2;
 		}
 
-		playback->push_buffer(buf);
+		// Whole blocks only, so the push array never changes size.
+		const int divisor = synthesis_rate_divisor;
+		const bool sends_active = (int)effect_send_outputs.size() == output_count;
+		while (frames_available >= k_block_frames) {
+			const int frames = k_block_frames;
+			const double block_end_sec = synth_time_sec + (double)frames / (double)sample_rate;
+			// While a recorded pass plays, events only keep the sequencer state current.
+			if (p_process_events) {
+				// Apply midi_speed to convert real time to MIDI time
+				uint32_t block_end_ms = (uint32_t)(block_end_sec * 1000.0 * midi_speed);
+				if (queued_midi && !queued_switch_done && block_end_ms >= queued_switch_ms) {
+					// The old sequence's events on the switch point would only be cut off again by the switch.
+					if (queued_switch_ms > 0) {
+						_process_events_until_ms(queued_switch_ms - 1, loop_cache_replaying);
+					}
+					_switch_to_queued_midi();
+					block_end_ms = (uint32_t)((synth_time_sec + (double)frames / (double)sample_rate) * 1000.0 * midi_speed);
+				}
+				_process_events_until_ms(block_end_ms, loop_cache_replaying);
+			}
 
-		synth_time_sec = block_end_sec;
-		frames_available -= frames;
+			// Anything that changed the render since the pass started ends the recording or replay.
+			if (!p_process_events && loop_cache.get_state() == MidiLoopCache::STATE_RECORDING) {
+				loop_cache.invalidate();
+			} else if (p_process_events && (loop_cache_replaying || loop_cache.get_state() == MidiLoopCache::STATE_RECORDING) &&
+					_get_loop_cache_key() != loop_cache.get_key()) {
+				if (loop_cache_replaying) {
+					_leave_loop_cache_replay();
+				} else {
+					loop_cache.invalidate();
+				}
+			}
+			const float *cached = nullptr;
+			if (loop_cache_replaying && p_process_events) {
+				cached = loop_cache.read(frames);
+				if (!cached) {
+					_leave_loop_cache_replay();
+				}
+			}
 
-		// If we're past the MIDI length and there are no active voices, stop/loop.
-		if (p_process_events && !event_cursor) {
-			if (tsf_active_voice_count(sf) == 0) {
-				if (loop) {
-					play();
+			if (cached) {
+				_push_block(playback, cached);
+			} else {
+				_render_synth(sf, targets, output_count, frames / divisor);
+				render_frames_accum += (uint64_t)frames;
+
+				for (int o = 0; o < output_count; o++) {
+					AudioStreamGeneratorPlayback *target = o == 0 ? playback : stems[o - 1].playback;
+					if (!target) {
+						continue;
+					}
+					float *out = targets[o];
+					if (divisor > 1) {
+						MidiUpsampler &up = o == 0 ? upsampler : stems[o - 1].upsampler;
+						up.process(targets[o], frames / divisor, upsample_block.data());
+						out = upsample_block.data();
+					}
+					if (o == 0 && loop_cache_fade) {
+						for (int i = 0; i < frames; i++) {
+							const float t = (float)(i + 1) / (float)frames;
+							out[i * 2] = out[i * 2] * t + loop_cache_fade[i * 2] * (1.0f - t);
+							out[i * 2 + 1] = out[i * 2 + 1] * t + loop_cache_fade[i * 2 + 1] * (1.0f - t);
+						}
+						loop_cache_fade = nullptr;
+					}
+					if (o == 0 && p_process_events) {
+						loop_cache.record(out, frames);
+					}
+					_push_block(target, out);
+					if (sends_active) {
+						_push_effect_sends(o, frames / divisor, divisor);
+					}
 				}
+			}
+			perf_stats.frames_pushed += frames;
+
+			synth_time_sec += (double)frames / (double)sample_rate;
+			frames_available -= frames;
+
+			// If we're past the MIDI length and there are no active voices, stop/loop.
+			// A replayed pass ends where its recording did.
+			if (p_process_events && (loop_cache_replaying ? loop_cache.is_at_end() : (_is_sequence_finished() && tsf_active_voice_count(sf) == 0))) {
+				loop_cache.finish_recording();
+				restart = loop;
 				break;
 			}
 		}
+		if (trace.is_active()) {
+			trace.voices = tsf_active_voice_count(sf);
+			trace.events = (int64_t)(dispatcher.events_dispatched - events_before);
+		}
+	}
+	_finish_midi_switch();
+	// Restarting resets the synth and the generators, which is not real-time safe.
+	if (restart) {
+		play();
 	}
 }
 
@@ -750,33 +2556,37 @@ void MidiPlayer::_pump_notes_audio() {
 		return;
 	}
 
-	int frames_available = notes_playback->get_frames_available();
-	if (frames_available <= 0) {
+	_count_underruns(notes_playback, notes_playback_skips);
+	int frames_available = _limit_to_buffer_target(notes_playback->get_frames_available());
+	if (frames_available < k_block_frames) {
 		return;
 	}
+	buffer_primed = true;
 
-	std::vector<float> interleaved;
-	interleaved.resize((size_t)k_block_frames * 2);
-
-	while (frames_available > 0) {
-		const int frames = std::min(frames_available, k_block_frames);
+	MIDI_RT_SCOPE("MidiPlayer::_pump_notes_audio");
+	MidiTraceScope trace("MidiPlayer::_pump_notes_audio");
+	if (trace.is_active()) {
+		trace.voices = tsf_active_voice_count(notes_sf);
+	}
+	MidiDenormalScope denormals;
+	// The notes synth renders into the main output's scratch block; both pumps run on the same thread.
+	float *target = render_blocks.data();
+	const int divisor = synthesis_rate_divisor;
+	while (frames_available >= k_block_frames) {
+		const int frames = k_block_frames;
 		const double block_end_sec = notes_time_sec + (double)frames / (double)sample_rate;
 
-		if ((int)interleaved.size() < frames * 2) {
-			interleaved.resize((size_t)frames * 2);
-		}
-
-		tsf_render_float(notes_sf, interleaved.data(), frames, 0);
+		_render_synth(notes_sf, &target, 1, frames / divisor);
+		notes_render_frames_accum += (uint64_t)frames;
 
-		PackedVector2Array buf;
-		buf.resize(frames);
-		for (int i = 0; i < frames; i++) {
-			const float l = interleaved[i * 2 + 0];
-			const float r = interleaved[i * 2 + 1];
-			buf.set(i, Vector2(l, r));
+		const float *out = target;
+		if (divisor > 1) {
+			notes_upsampler.process(target, frames / divisor, upsample_block.data());
+			out = upsample_block.data();
 		}
+		_push_block(notes_playback, out);
+		perf_stats.frames_pushed += frames;
 
-		notes_playback->push_buffer(buf);
 		notes_time_sec = block_end_sec;
 		frames_available -= frames;
 
@@ -788,12 +2598,37 @@ void MidiPlayer::_pump_notes_audio() {
 
 void MidiPlayer::_process(double p_delta) {
 	(void)p_delta;
+	MidiTraceScope trace("MidiPlayer::_process");
+	if (trace.is_active()) {
+		trace.frame = (int64_t)Engine::get_singleton()->get_process_frames();
+	}
+	if (culled) {
+		if (playing && !paused) {
+			_prefetch_stream();
+			_advance_culled(p_delta);
+		}
+		playback_skips = -1;
+		notes_playback_skips = -1;
+		buffer_primed = false;
+		_update_performance_stats();
+		// No voices can sound while culled, so a stopped or paused player goes to sleep.
+		_update_idle(p_delta);
+		return;
+	}
+
+	_update_adaptive_buffer(p_delta);
+	_update_effect_sends();
+
+	bool fed_main = false;
+	bool fed_notes = false;
 	if (playing && !paused) {
 		_ensure_audio_setup();
+		_prefetch_stream();
 		_pump_audio(true);
+		fed_main = true;
 
-		// Auto-stop when finished (non-loop).
-		if (!loop && !event_cursor && sf && tsf_active_voice_count(sf) == 0) {
+		// Auto-stop when finished (non-loop). A replayed pass has no voices but may still hold release tails.
+		if (!loop && !loop_cache_replaying && _is_sequence_finished() && sf && tsf_active_voice_count(sf) == 0) {
 			stop();
 		}
 	} else {
@@ -801,6 +2636,7 @@ void MidiPlayer::_process(double p_delta) {
 		if (!use_separate_notes_bus && sf && tsf_active_voice_count(sf) > 0) {
 			_ensure_audio_setup();
 			_pump_audio(false);
+			fed_main = true;
 		}
 	}
 
@@ -808,7 +2644,24 @@ void MidiPlayer::_process(double p_delta) {
 	if (use_separate_notes_bus && notes_sf && tsf_active_voice_count(notes_sf) > 0) {
 		_ensure_notes_audio_setup();
 		_pump_notes_audio();
+		fed_notes = true;
 	}
+
+	// A generator left idle drains on purpose; that silence is not an underrun.
+	if (!fed_main) {
+		playback_skips = -1;
+	}
+	if (!fed_notes) {
+		notes_playback_skips = -1;
+	}
+	if (!fed_main && !fed_notes) {
+		buffer_primed = false;
+	}
+
+	_update_adaptive_quality();
+	_update_performance_stats();
+	_update_idle(p_delta);
+	MIDI_RT_AUDIT_FLUSH();
 }
 
 } // namespace godot
@@ -1,13 +1,24 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 #include <godot_cpp/classes/audio_stream_generator.hpp>
 #include <godot_cpp/classes/audio_stream_generator_playback.hpp>
 #include <godot_cpp/classes/audio_stream_player.hpp>
+#include <godot_cpp/classes/audio_stream_wav.hpp>
 #include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
 #include <godot_cpp/templates/vector.hpp>
 
+#include "midi_audio_output.h"
+#include "midi_dispatch.h"
+#include "midi_loop_cache.h"
+#include "midi_note_index.h"
+#include "midi_resampler.h"
+#include "midi_smf_stream.h"
+#include "midi_tempo_map.h"
 #include "midi_resources.h"
 
 // TinySoundFont / TinyMidiLoader forward declarations.
@@ -20,6 +31,19 @@ class MidiPlayer : public Node {
 	GDCLASS(MidiPlayer, Node)
 
 public:
+	enum VoiceStealPolicy {
+		VOICE_STEAL_OLDEST,
+		VOICE_STEAL_QUIETEST,
+		VOICE_STEAL_LOWEST_PRIORITY,
+		VOICE_STEAL_RELEASED_FIRST,
+	};
+
+	enum Interpolation {
+		INTERPOLATION_NEAREST,
+		INTERPOLATION_LINEAR,
+		INTERPOLATION_CUBIC,
+	};
+
 	MidiPlayer();
 	~MidiPlayer();
 
@@ -27,14 +51,32 @@ public:
 	Ref<SoundFontResource> get_soundfont() const;
 
 	void set_midi(const Ref<MidiFileResource> &p_resource);
+	// Plays a script-built MidiSequence instead of the MIDI file while set.
+	void set_sequence(const Ref<MidiSequence> &p_sequence);
+	Ref<MidiSequence> get_sequence() const;
 	Ref<MidiFileResource> get_midi() const;
 
+	// MIDI data of at least this size is decoded incrementally during playback
+	// instead of being expanded up front (0: never). Streamed files have no note
+	// index, and get_length_seconds() grows as they are decoded.
+	void set_stream_threshold_kb(int p_kb);
+	int get_stream_threshold_kb() const;
+	bool is_streaming() const;
+
 	void set_loop(bool p_loop);
 	bool get_loop() const;
 
 	void set_looping(bool p_looping);
 	bool is_looping() const;
 
+	// Loop cache: while looping, the first pass is recorded (up to loop_cache_mb of
+	// PCM) and later passes replay it instead of synthesizing. Live notes, tempo,
+	// mute and other render settings fall back to synthesis mid-pass; the next pass
+	// records again. Only used with a single output and effect_sends off.
+	void set_loop_cache_mb(float p_mb);
+	float get_loop_cache_mb() const;
+	bool is_loop_cache_replaying() const;
+
 	void set_midi_speed(float p_speed);
 	float get_midi_speed() const;
 
@@ -44,9 +86,70 @@ public:
 	void set_generator_buffer_length(float p_seconds);
 	float get_generator_buffer_length() const;
 
+	// Adaptive buffer: only fill the generators up to a target length that shrinks
+	// while playback stays healthy and grows after near-underruns, between
+	// min_buffer_length and generator_buffer_length.
+	void set_adaptive_buffer(bool p_enable);
+	bool get_adaptive_buffer() const;
+	void set_min_buffer_length(float p_seconds);
+	float get_min_buffer_length() const;
+	float get_buffer_target_length() const;
+
+	void set_max_voices(int p_max_voices);
+	int get_max_voices() const;
+
+	void set_voice_steal_policy(VoiceStealPolicy p_policy);
+	VoiceStealPolicy get_voice_steal_policy() const;
+
+	// Per-channel polyphony cap (0 = unlimited) and stealing priority (higher survives longer).
+	void set_channel_voice_limit(int p_channel, int p_limit);
+	int get_channel_voice_limit(int p_channel) const;
+	void set_channel_priority(int p_channel, int p_priority);
+	int get_channel_priority(int p_channel) const;
+
+	// Synthesize at mix_rate / divisor (1, 2 or 4) and upsample to the mix rate.
+	void set_synthesis_rate_divisor(int p_divisor);
+	int get_synthesis_rate_divisor() const;
+
+	void set_interpolation(Interpolation p_interpolation);
+	Interpolation get_interpolation() const;
+
+	// Adaptive quality: when rendering takes more than render_budget of the audio
+	// block duration for a quarter second, the player steps down quality_level
+	// (fewer voices, lower interpolation, no static filter on released voices, quiet
+	// release tails culled) and steps back up after a second of low load.
+	void set_adaptive_quality(bool p_enable);
+	bool get_adaptive_quality() const;
+	void set_render_budget(float p_fraction);
+	float get_render_budget() const;
+	int get_quality_level() const;
+
 	void set_audio_bus(const StringName &p_bus);
 	StringName get_audio_bus() const;
 
+	// Muted (or non-soloed) channels keep tracking program/controller state but
+	// start no voices. Unmuting restarts notes the sequence is still holding.
+	void set_channel_muted(int p_channel, bool p_muted);
+	bool is_channel_muted(int p_channel) const;
+	void set_channel_solo(int p_channel, bool p_solo);
+	bool is_channel_solo(int p_channel) const;
+
+	// Stems: output 0 is the main output on audio_bus; outputs 1..count-1 get their
+	// own generator and bus. Channels are routed to outputs in a single render pass.
+	void set_output_count(int p_count);
+	int get_output_count() const;
+	void set_output_bus(int p_output, const StringName &p_bus);
+	StringName get_output_bus(int p_output) const;
+	void set_channel_output(int p_channel, int p_output);
+	int get_channel_output(int p_channel) const;
+
+	// Feed each channel's CC91/CC93 send levels into the reverb and chorus shared by
+	// every player on the same bus (see MidiEffectBuses).
+	void set_effect_sends(bool p_enable);
+	bool get_effect_sends() const;
+	static void set_bus_reverb(const StringName &p_bus, float p_room_size, float p_damping, float p_level);
+	static void set_bus_chorus(const StringName &p_bus, float p_depth_ms, float p_rate_hz, float p_level);
+
 	void set_use_separate_notes_bus(bool p_enable);
 	bool get_use_separate_notes_bus() const;
 
@@ -57,6 +160,16 @@ public:
 	bool load_midi(const String &p_path);
 
 	void play();
+	// Switches to p_resource on the same synth at a musical boundary of the current
+	// sequence: "next_bar", "next_beat", or a song time in seconds. The new file is
+	// parsed now; sounding notes release naturally and channels start from their
+	// default program, controllers and pitch bend. Emits queued_midi_started.
+	void queue_midi(const Ref<MidiFileResource> &p_resource, const Variant &p_at = "next_bar");
+	void cancel_queued_midi();
+	bool has_queued_midi() const;
+	// TinyMidiLoader drops time signatures, so bar length is set here (in beats).
+	void set_beats_per_bar(int p_beats);
+	int get_beats_per_bar() const;
 	void stop();
 	void pause();
 	void resume();
@@ -66,18 +179,77 @@ public:
 	void note_off(int p_preset_index, int p_key);
 	void note_off_all();
 
+	// One-shot cache: renders a (preset, key, velocity, duration) note once to PCM
+	// and replays it through a polyphonic stream without any synthesis.
+	Ref<AudioStreamWAV> prerender_note(int p_preset_index, int p_key, float p_velocity, float p_duration_sec);
+	int play_cached_note(int p_preset_index, int p_key, float p_velocity, float p_duration_sec, float p_volume_db = 0.0f);
+	void clear_note_cache();
+
 	float get_length_seconds() const;
 	float get_playback_position_seconds() const;
 
+	// True while a spatial player is out of hearing range and only tracks the sequence.
+	bool is_culled() const;
+	// True while the player has nothing to render: processing is off and its
+	// generators have left the mix. note_on() and play() wake it.
+	bool is_idle() const;
+
+	// Note queries against the index built at load time. Times are song seconds.
+	Dictionary get_notes_in_range(float p_from_sec, float p_to_sec, int p_channel_mask = 0xFFFF) const;
+	int get_note_count() const;
+
+	// Same figures as the "MidiPlayer/..." Performance monitors, for this player only.
+	Dictionary get_performance_stats() const;
+	void reset_performance_stats();
+
+	// Snapshot of the playback position, sequencer and synth state (channel programs and
+	// controllers, playing voices). Restoring needs the same MIDI file and SoundFont and
+	// costs the same at any point in the song. Not available for streamed files.
+	PackedByteArray capture_state() const;
+	bool restore_state(const PackedByteArray &p_state, bool p_flush_audio = true);
+
+	// Timeline of pumps, event dispatch, renders, pushes and loads on every thread,
+	// saved as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+	static void start_trace(int p_events_per_thread);
+	static void stop_trace();
+	static bool is_tracing();
+	static Error save_trace(const String &p_path);
+
 	// Virtual methods (public for godot-cpp binding)
+	void _enter_tree() override;
 	void _ready() override;
 	void _exit_tree() override;
 	void _process(double p_delta) override;
 
 protected:
+	friend class MidiPerformanceMonitors;
+
 	static void _bind_methods();
+	// Creates the node the generator stream is played through. Spatial players
+	// override this to return an AudioStreamPlayer2D/3D.
+	virtual Node *_create_output_node();
+	// Distance LOD for spatial players: culls rendering beyond p_audible and
+	// reduces polyphony/interpolation between p_lod_start and p_audible.
+	void _update_distance_lod(float p_distance, float p_lod_start, float p_audible);
+	// Places the spatial outputs at the anchor and updates the distance LOD. Runs
+	// every frame and on waking up, since a sleeping player does not track distance.
+	virtual void _update_spatial() {}
+	void _set_culled(bool p_culled);
+	void _release_audio_outputs();
+	void _update_effect_sends();
+	void _leave_effect_buses();
+	void _render_with_sends(tsf *p_synth, float *const *p_buffers, int p_buffer_count, int p_frames);
+	void _push_effect_sends(int p_output, int p_synth_frames, int p_divisor);
+	void _wake();
+	static void _build_event_table(const tml_message *p_first, std::vector<const tml_message *> &r_table);
+	int _get_event_index(const tml_message *p_message) const;
+	void _update_idle(double p_delta);
+	void _advance_culled(double p_delta);
 	void _ensure_audio_setup();
+	void _ensure_stem_outputs();
+	void _stop_stem_outputs();
 	void _ensure_notes_audio_setup();
+	void _ensure_one_shot_setup();
 	void _clear_audio_buffer();
 	void _clear_notes_audio_buffer();
 	void _reset_synth();
@@ -86,10 +258,39 @@ protected:
 	bool _load_notes_soundfont_bytes(const PackedByteArray &p_bytes);
 	bool _load_midi_bytes(const PackedByteArray &p_bytes);
 	static PackedByteArray _read_all_bytes(const String &p_path);
-	void _apply_event(const tml_message *p_msg);
-	void _process_events_until_ms(uint32_t p_time_ms);
+	int _get_synth_sample_rate() const;
+	void _configure_synth(tsf *p_synth);
+	bool _make_room_for_voice(tsf *p_synth, int p_channel, int p_voices);
+	int _get_effective_max_voices() const;
+	void _cull_voices(tsf *p_synth, int p_keep);
+	void _apply_quality_to_block(tsf *p_synth);
+	int _get_effective_interpolation() const;
+	void _render_synth(tsf *p_synth, float *const *p_buffers, int p_buffer_count, int p_frames);
+	void _push_block(AudioStreamGeneratorPlayback *p_playback, const float *p_interleaved);
+	void _update_adaptive_quality();
+	void _update_performance_stats();
+	void _update_adaptive_buffer(double p_delta);
+	int _limit_to_buffer_target(int p_frames_available);
+	void _count_underruns(AudioStreamGeneratorPlayback *p_playback, int64_t &r_last_skips);
+	int _get_active_voice_count() const;
+	int64_t _get_sample_memory_bytes() const;
+	void _set_audible_mask(uint16_t p_muted, uint16_t p_solo);
+	void _retrigger_held_notes(uint16_t p_channel_mask);
+	// p_silent applies channel state but starts no notes (used while culled).
+	void _process_events_until_ms(uint32_t p_time_ms, bool p_silent = false);
 	void _pump_audio(bool p_process_events);
 	void _pump_notes_audio();
+	void _switch_to_queued_midi();
+	void _finish_midi_switch();
+	bool _has_sequence() const;
+	bool _is_sequence_finished() const;
+	void _rewind_sequence();
+	void _prefetch_stream();
+	bool _is_loop_cache_eligible() const;
+	uint64_t _get_loop_cache_key() const;
+	void _begin_loop_cache_pass();
+	void _cancel_loop_cache_pass();
+	void _leave_loop_cache_replay();
 
 	Ref<SoundFontResource> soundfont_resource;
 	Ref<MidiFileResource> midi_resource;
@@ -99,27 +300,141 @@ protected:
 	float volume = 1.0f; // linear gain
 	float midi_speed = 1.0f; // playback speed multiplier
 	float generator_buffer_length = 0.5f;
+	int max_voices = 256;
+	int synthesis_rate_divisor = 1;
+	Interpolation interpolation = INTERPOLATION_LINEAR;
+	bool adaptive_quality = false;
+	float render_budget = 0.5f; // fraction of the rendered audio duration
+	int quality_level = 0;
+	uint64_t render_usec_accum = 0;
+	uint64_t render_frames_accum = 0;
+	uint64_t notes_render_frames_accum = 0;
+	int quality_calm_frames = 0;
+	int quality_busy_frames = 0;
+	bool adaptive_buffer = false;
+	float min_buffer_length = 0.05f;
+	float buffer_target_length = 0.5f;
+	int buffer_capacity_frames = 0; // largest get_frames_available() seen, i.e. an empty generator
+	bool buffer_primed = false; // false until the first push after a restart
+	double buffer_calm_sec = 0.0;
+	int64_t buffer_underruns_seen = 0;
+
+	// Idle: no sequence playing and no voices. Entered once the generators have
+	// had time to play out what was already pushed.
+	bool idle = true;
+	double idle_pending_sec = 0.0;
+
+	// Distance LOD state, driven by spatial subclasses.
+	bool culled = false;
+	int lod_voice_cap = 0; // 0 = no limit
+	int lod_interpolation_drop = 0;
 	StringName audio_bus = "Master";
 	bool use_separate_notes_bus = false;
 	StringName notes_audio_bus = "Master";
 
 	// Godot audio output
-	AudioStreamPlayer *player = nullptr;
+	MidiAudioOutput player;
 	Ref<AudioStreamGenerator> generator;
 	Ref<AudioStreamPlayback> playback_base;
 	AudioStreamGeneratorPlayback *playback = nullptr; // borrowed from playback_base
 
-	AudioStreamPlayer *notes_player = nullptr;
+	MidiAudioOutput notes_player;
 	Ref<AudioStreamGenerator> notes_generator;
 	Ref<AudioStreamPlayback> notes_playback_base;
 	AudioStreamGeneratorPlayback *notes_playback = nullptr; // borrowed from notes_playback_base
+
+	MidiAudioOutput one_shot_player;
+	Ref<AudioStreamPlayback> one_shot_playback; // AudioStreamPlaybackPolyphonic
+	HashMap<uint64_t, Ref<AudioStreamWAV>> note_cache;
 	int sample_rate = 44100;
+	MidiUpsampler upsampler;
+	// Preallocated render scratch: k_max_outputs stereo blocks, one upsampled block, one push array.
+	std::vector<float> render_blocks;
+	std::vector<float> upsample_block;
+	PackedVector2Array push_block;
+	MidiUpsampler notes_upsampler;
+
+	// Shared send effects: one entry per output while effect_sends is on and the synth renders.
+	struct EffectSendOutput {
+		StringName bus;
+		int slot = -1;
+		int64_t cursor = 0;
+		float last[4] = {}; // last reverb and chorus frames, for upsampling reduced-rate sends
+	};
+	std::vector<EffectSendOutput> effect_send_outputs;
+	bool effect_sends = false;
+	std::vector<float> channel_blocks; // 17 stereo blocks: channels 0-15, then channel-less voices
+	std::vector<float> send_blocks; // per output: reverb block, chorus block
+	std::vector<float> send_upsampled;
+
+	// Extra outputs (output index 1..n) fed from the main synth's render pass.
+	struct StemOutput {
+		MidiAudioOutput output;
+		Ref<AudioStreamGenerator> generator;
+		Ref<AudioStreamPlayback> playback_base;
+		AudioStreamGeneratorPlayback *playback = nullptr; // borrowed from playback_base
+		StringName bus = "Master";
+		MidiUpsampler upsampler;
+	};
+	std::vector<StemOutput> stems;
+	int channel_outputs[16] = {};
 
 	// Synth/midi
 	tsf *sf = nullptr;
 	tsf *notes_sf = nullptr;
 	tml_message *midi = nullptr;
-	tml_message *event_cursor = nullptr;
+	const tml_message *event_cursor = nullptr;
+	// Script-built sequence played instead of midi while set. sequence_last is the
+	// last message applied, valid while the list's generation is unchanged.
+	Ref<MidiSequence> sequence;
+	const tml_message *sequence_last = nullptr;
+	uint32_t sequence_generation = 0;
+	// Every message of midi in order, so a saved state's cursor maps back in O(1).
+	std::vector<const tml_message *> event_table;
+	// Large files play from smf_stream instead of midi; stream_bytes keeps the data alive.
+	MidiSmfStream smf_stream;
+	PackedByteArray stream_bytes;
+	bool streaming = false;
+	int stream_threshold_kb = 4096;
+	// Voice policy, mute/solo and held-note state live here (shared with the native tools).
+	MidiEventDispatcher dispatcher;
+
+	struct PerformanceStats {
+		double render_usec_per_block = 0.0; // during the last tick
+		int peak_voices = 0;
+		int64_t underruns = 0; // generator skips: the mixer found the buffer empty
+		int64_t frames_pushed = 0;
+		int event_backlog = 0; // events that came due and were dispatched in the last tick
+	};
+	PerformanceStats perf_stats;
+	uint64_t perf_render_usec = 0;
+	int perf_render_blocks = 0;
+	uint64_t perf_events_mark = 0;
+	int64_t playback_skips = -1; // -1: generator not fed last frame
+	int64_t notes_playback_skips = -1;
+	MidiNoteIndex note_index;
+	MidiTempoMap tempo_map;
+	int beats_per_bar = 4;
+
+	// Sequence waiting for its queue_midi() switch point, parsed ahead of time.
+	// After the switch (inside the render scope) these hold the retired sequence
+	// until _finish_midi_switch() frees it outside.
+	Ref<MidiFileResource> queued_resource;
+	tml_message *queued_midi = nullptr;
+	MidiNoteIndex queued_note_index;
+	std::vector<const tml_message *> queued_event_table;
+	MidiTempoMap queued_tempo_map;
+	uint32_t queued_length_ms = 0;
+	uint32_t queued_switch_ms = 0; // in the current sequence's MIDI time
+	bool queued_switch_done = false;
+
+	// Loop cache (see set_loop_cache_mb()). loop_cache_epoch is bumped by what the key
+	// cannot see: live notes, loads, MIDI switches and restored states.
+	MidiLoopCache loop_cache;
+	float loop_cache_mb = 0.0f;
+	bool loop_cache_replaying = false;
+	uint32_t loop_cache_epoch = 0;
+	const float *loop_cache_fade = nullptr; // cached block the first live block fades in over
 
 	uint32_t midi_length_ms = 0;
 	bool playing = false;
@@ -131,3 +446,6 @@ protected:
 };
 
 } // namespace godot
+
+VARIANT_ENUM_CAST(MidiPlayer::VoiceStealPolicy);
+VARIANT_ENUM_CAST(MidiPlayer::Interpolation);
@@ -0,0 +1,161 @@
+#include "midi_player_spatial.h"
+
+#include <algorithm>
+
+#include <godot_cpp/classes/audio_stream_player2d.hpp>
+#include <godot_cpp/classes/audio_stream_player3d.hpp>
+#include <godot_cpp/classes/camera2d.hpp>
+#include <godot_cpp/classes/camera3d.hpp>
+#include <godot_cpp/classes/node2d.hpp>
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/classes/viewport.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+namespace godot {
+
+// The output nodes are children of a plain Node, so they don't inherit a
+// transform; copy the anchor's every frame.
+template <typename T, typename Transform>
+static void _place_output(const MidiAudioOutput &p_output, const Transform &p_transform) {
+	T *node = Object::cast_to<T>(p_output.get_node());
+	if (node && node->is_inside_tree()) {
+		node->set_global_transform(p_transform);
+	}
+}
+
+void MidiPlayer3D::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_audible_distance", "distance"), &MidiPlayer3D::set_audible_distance);
+	ClassDB::bind_method(D_METHOD("get_audible_distance"), &MidiPlayer3D::get_audible_distance);
+	ClassDB::add_property("MidiPlayer3D", PropertyInfo(Variant::FLOAT, "audible_distance", PROPERTY_HINT_RANGE, "0.0,4096.0,0.01,or_greater,suffix:m"), "set_audible_distance", "get_audible_distance");
+
+	ClassDB::bind_method(D_METHOD("set_lod_start_distance", "distance"), &MidiPlayer3D::set_lod_start_distance);
+	ClassDB::bind_method(D_METHOD("get_lod_start_distance"), &MidiPlayer3D::get_lod_start_distance);
+	ClassDB::add_property("MidiPlayer3D", PropertyInfo(Variant::FLOAT, "lod_start_distance", PROPERTY_HINT_RANGE, "0.0,4096.0,0.01,or_greater,suffix:m"), "set_lod_start_distance", "get_lod_start_distance");
+}
+
+Node *MidiPlayer3D::_create_output_node() {
+	AudioStreamPlayer3D *node = memnew(AudioStreamPlayer3D);
+	node->set_max_distance(audible_distance);
+	return node;
+}
+
+void MidiPlayer3D::set_audible_distance(float p_distance) {
+	audible_distance = std::max(0.0f, p_distance);
+	for (const MidiAudioOutput *output : { &player, &notes_player, &one_shot_player }) {
+		if (AudioStreamPlayer3D *node = Object::cast_to<AudioStreamPlayer3D>(output->get_node())) {
+			node->set_max_distance(audible_distance);
+		}
+	}
+	for (const StemOutput &stem : stems) {
+		if (AudioStreamPlayer3D *node = Object::cast_to<AudioStreamPlayer3D>(stem.output.get_node())) {
+			node->set_max_distance(audible_distance);
+		}
+	}
+}
+
+float MidiPlayer3D::get_audible_distance() const {
+	return audible_distance;
+}
+
+void MidiPlayer3D::set_lod_start_distance(float p_distance) {
+	lod_start_distance = std::max(0.0f, p_distance);
+}
+
+float MidiPlayer3D::get_lod_start_distance() const {
+	return lod_start_distance;
+}
+
+void MidiPlayer3D::_process(double p_delta) {
+	_update_spatial();
+	MidiPlayer::_process(p_delta);
+}
+
+void MidiPlayer3D::_update_spatial() {
+	Node3D *anchor = Object::cast_to<Node3D>(get_parent());
+	if (anchor) {
+		const Transform3D xform = anchor->get_global_transform();
+		_place_output<AudioStreamPlayer3D>(player, xform);
+		_place_output<AudioStreamPlayer3D>(notes_player, xform);
+		_place_output<AudioStreamPlayer3D>(one_shot_player, xform);
+		for (const StemOutput &stem : stems) {
+			_place_output<AudioStreamPlayer3D>(stem.output, xform);
+		}
+
+		Viewport *viewport = get_viewport();
+		Camera3D *camera = viewport ? viewport->get_camera_3d() : nullptr;
+		if (camera) {
+			_update_distance_lod(camera->get_global_position().distance_to(xform.origin), lod_start_distance, audible_distance);
+		}
+	}
+}
+
+void MidiPlayer2D::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_audible_distance", "distance"), &MidiPlayer2D::set_audible_distance);
+	ClassDB::bind_method(D_METHOD("get_audible_distance"), &MidiPlayer2D::get_audible_distance);
+	ClassDB::add_property("MidiPlayer2D", PropertyInfo(Variant::FLOAT, "audible_distance", PROPERTY_HINT_RANGE, "0.0,100000.0,1.0,or_greater,suffix:px"), "set_audible_distance", "get_audible_distance");
+
+	ClassDB::bind_method(D_METHOD("set_lod_start_distance", "distance"), &MidiPlayer2D::set_lod_start_distance);
+	ClassDB::bind_method(D_METHOD("get_lod_start_distance"), &MidiPlayer2D::get_lod_start_distance);
+	ClassDB::add_property("MidiPlayer2D", PropertyInfo(Variant::FLOAT, "lod_start_distance", PROPERTY_HINT_RANGE, "0.0,100000.0,1.0,or_greater,suffix:px"), "set_lod_start_distance", "get_lod_start_distance");
+}
+
+Node *MidiPlayer2D::_create_output_node() {
+	AudioStreamPlayer2D *node = memnew(AudioStreamPlayer2D);
+	node->set_max_distance(audible_distance);
+	return node;
+}
+
+void MidiPlayer2D::set_audible_distance(float p_distance) {
+	audible_distance = std::max(0.0f, p_distance);
+	for (const MidiAudioOutput *output : { &player, &notes_player, &one_shot_player }) {
+		if (AudioStreamPlayer2D *node = Object::cast_to<AudioStreamPlayer2D>(output->get_node())) {
+			node->set_max_distance(audible_distance);
+		}
+	}
+	for (const StemOutput &stem : stems) {
+		if (AudioStreamPlayer2D *node = Object::cast_to<AudioStreamPlayer2D>(stem.output.get_node())) {
+			node->set_max_distance(audible_distance);
+		}
+	}
+}
+
+float MidiPlayer2D::get_audible_distance() const {
+	return audible_distance;
+}
+
+void MidiPlayer2D::set_lod_start_distance(float p_distance) {
+	lod_start_distance = std::max(0.0f, p_distance);
+}
+
+float MidiPlayer2D::get_lod_start_distance() const {
+	return lod_start_distance;
+}
+
+void MidiPlayer2D::_process(double p_delta) {
+	_update_spatial();
+	MidiPlayer::_process(p_delta);
+}
+
+void MidiPlayer2D::_update_spatial() {
+	Node2D *anchor = Object::cast_to<Node2D>(get_parent());
+	Viewport *viewport = get_viewport();
+	if (anchor && viewport) {
+		const Transform2D xform = anchor->get_global_transform();
+		_place_output<AudioStreamPlayer2D>(player, xform);
+		_place_output<AudioStreamPlayer2D>(notes_player, xform);
+		_place_output<AudioStreamPlayer2D>(one_shot_player, xform);
+		for (const StemOutput &stem : stems) {
+			_place_output<AudioStreamPlayer2D>(stem.output, xform);
+		}
+
+		Vector2 listener;
+		if (Camera2D *camera = viewport->get_camera_2d()) {
+			listener = camera->get_screen_center_position();
+		} else {
+			listener = viewport->get_canvas_transform().affine_inverse().xform(viewport->get_visible_rect().get_center());
+		}
+		_update_distance_lod(listener.distance_to(xform.get_origin()), lod_start_distance, audible_distance);
+	}
+}
+
+} // namespace godot
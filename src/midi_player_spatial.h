@@ -0,0 +1,57 @@
+#pragma once
+
+#include "midi_player.h"
+
+namespace godot {
+
+// MidiPlayer that outputs through an AudioStreamPlayer3D placed at its parent
+// Node3D. Beyond audible_distance from the active Camera3D the sequence keeps
+// running without rendering; between lod_start_distance and audible_distance
+// polyphony and interpolation are reduced with distance.
+class MidiPlayer3D : public MidiPlayer {
+	GDCLASS(MidiPlayer3D, MidiPlayer)
+
+public:
+	void set_audible_distance(float p_distance);
+	float get_audible_distance() const;
+
+	void set_lod_start_distance(float p_distance);
+	float get_lod_start_distance() const;
+
+	void _process(double p_delta) override;
+
+protected:
+	static void _bind_methods();
+	Node *_create_output_node() override;
+	void _update_spatial() override;
+
+private:
+	float audible_distance = 50.0f;
+	float lod_start_distance = 15.0f;
+};
+
+// 2D counterpart of MidiPlayer3D: AudioStreamPlayer2D at the parent Node2D,
+// distances measured to the active Camera2D (or the viewport center).
+class MidiPlayer2D : public MidiPlayer {
+	GDCLASS(MidiPlayer2D, MidiPlayer)
+
+public:
+	void set_audible_distance(float p_distance);
+	float get_audible_distance() const;
+
+	void set_lod_start_distance(float p_distance);
+	float get_lod_start_distance() const;
+
+	void _process(double p_delta) override;
+
+protected:
+	static void _bind_methods();
+	Node *_create_output_node() override;
+	void _update_spatial() override;
+
+private:
+	float audible_distance = 2000.0f;
+	float lod_start_distance = 500.0f;
+};
+
+} // namespace godot
@@ -0,0 +1,84 @@
+#include "midi_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace godot {
+
+void MidiUpsampler::configure(int p_factor, int p_max_input_frames) {
+	factor = std::max(1, p_factor);
+	max_input_frames = std::max(1, p_max_input_frames);
+	history.assign((size_t)(k_taps_per_phase - 1 + max_input_frames) * 2, 0.0f);
+
+	coeffs.assign((size_t)factor * k_taps_per_phase, 0.0f);
+	if (factor == 1) {
+		return;
+	}
+
+	// Blackman-windowed sinc with its cutoff slightly below the input Nyquist,
+	// split into one sub-filter per output phase.
+	const double pi = 3.14159265358979323846;
+	const int length = factor * k_taps_per_phase;
+	const double center = (double)(length - 1) * 0.5;
+	const double cutoff = 0.9 / (double)factor; // relative to output Nyquist
+	for (int i = 0; i < length; i++) {
+		const double x = (double)i - center;
+		const double sinc = (x == 0.0) ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+		const double w = 0.42 - 0.5 * std::cos(2.0 * pi * (i + 0.5) / length) + 0.08 * std::cos(4.0 * pi * (i + 0.5) / length);
+		const int phase = i % factor;
+		const int tap = i / factor;
+		coeffs[(size_t)phase * k_taps_per_phase + tap] = (float)(sinc * w);
+	}
+
+	// Normalize each phase to unity DC gain so held input doesn't ripple.
+	for (int phase = 0; phase < factor; phase++) {
+		float *c = &coeffs[(size_t)phase * k_taps_per_phase];
+		double sum = 0.0;
+		for (int tap = 0; tap < k_taps_per_phase; tap++) {
+			sum += c[tap];
+		}
+		if (sum != 0.0) {
+			for (int tap = 0; tap < k_taps_per_phase; tap++) {
+				c[tap] = (float)(c[tap] / sum);
+			}
+		}
+	}
+}
+
+void MidiUpsampler::reset() {
+	std::fill(history.begin(), history.end(), 0.0f);
+}
+
+void MidiUpsampler::process(const float *p_in, int p_in_frames, float *p_out) {
+	if (factor == 1) {
+		memcpy(p_out, p_in, sizeof(float) * 2 * (size_t)p_in_frames);
+		return;
+	}
+	p_in_frames = std::min(p_in_frames, max_input_frames);
+
+	// history holds the last (taps - 1) input frames followed by the new block.
+	const int kept = k_taps_per_phase - 1;
+	float *h = history.data();
+	memcpy(h + kept * 2, p_in, sizeof(float) * 2 * (size_t)p_in_frames);
+
+	for (int m = 0; m < p_in_frames; m++) {
+		// Newest input frame for this output group is at history index kept + m.
+		const float *newest = h + (size_t)(kept + m) * 2;
+		for (int phase = 0; phase < factor; phase++) {
+			const float *c = &coeffs[(size_t)phase * k_taps_per_phase];
+			float l = 0.0f;
+			float r = 0.0f;
+			for (int tap = 0; tap < k_taps_per_phase; tap++) {
+				l += c[tap] * newest[-tap * 2 + 0];
+				r += c[tap] * newest[-tap * 2 + 1];
+			}
+			*p_out++ = l;
+			*p_out++ = r;
+		}
+	}
+
+	memmove(h, h + (size_t)p_in_frames * 2, sizeof(float) * 2 * (size_t)kept);
+}
+
+} // namespace godot
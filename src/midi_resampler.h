@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+namespace godot {
+
+// Integer-factor polyphase FIR upsampler for interleaved stereo float audio.
+// Used to synthesize at a fraction of the output mix rate.
+class MidiUpsampler {
+public:
+	static constexpr int k_taps_per_phase = 8;
+
+	// Sets the upsampling factor and the largest input block process() will see.
+	// Allocates here so that process() never does.
+	void configure(int p_factor, int p_max_input_frames);
+	void reset();
+
+	int get_factor() const { return factor; }
+
+	// Reads p_in_frames stereo frames from p_in and writes p_in_frames * factor
+	// stereo frames to p_out. p_in_frames must not exceed the configured maximum.
+	void process(const float *p_in, int p_in_frames, float *p_out);
+
+private:
+	int factor = 1;
+	int max_input_frames = 0;
+	std::vector<float> coeffs; // [phase * k_taps_per_phase + tap]
+	std::vector<float> history; // interleaved stereo: (k_taps_per_phase - 1) frames + input block
+};
+
+} // namespace godot
@@ -1,6 +1,9 @@
 #include "midi_resources.h"
 
+#include <cmath>
+
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
 
 namespace godot {
 
@@ -32,4 +35,135 @@ PackedByteArray SoundFontResource::get_data() const {
 	return data;
 }
 
+void MidiSequence::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("append_events", "times", "channels", "types", "data"), &MidiSequence::append_events);
+	ClassDB::bind_method(D_METHOD("append_notes", "times", "channels", "keys", "velocities", "durations"), &MidiSequence::append_notes);
+	ClassDB::bind_method(D_METHOD("clear"), &MidiSequence::clear);
+	ClassDB::bind_method(D_METHOD("get_event_count"), &MidiSequence::get_event_count);
+	ClassDB::bind_method(D_METHOD("get_length_seconds"), &MidiSequence::get_length_seconds);
+	ClassDB::bind_method(D_METHOD("set_complete", "complete"), &MidiSequence::set_complete);
+	ClassDB::bind_method(D_METHOD("is_complete"), &MidiSequence::is_complete);
+	ClassDB::add_property("MidiSequence", PropertyInfo(Variant::BOOL, "complete"), "set_complete", "is_complete");
+
+	BIND_ENUM_CONSTANT(EVENT_NOTE_OFF);
+	BIND_ENUM_CONSTANT(EVENT_NOTE_ON);
+	BIND_ENUM_CONSTANT(EVENT_KEY_PRESSURE);
+	BIND_ENUM_CONSTANT(EVENT_CONTROL_CHANGE);
+	BIND_ENUM_CONSTANT(EVENT_PROGRAM_CHANGE);
+	BIND_ENUM_CONSTANT(EVENT_CHANNEL_PRESSURE);
+	BIND_ENUM_CONSTANT(EVENT_PITCH_BEND);
+}
+
+static uint32_t sequence_time_ms(double p_seconds) {
+	return (uint32_t)std::llround(p_seconds * 1000.0);
+}
+
+void MidiSequence::append_events(const PackedFloat64Array &p_times, const PackedByteArray &p_channels, const PackedByteArray &p_types, const PackedInt32Array &p_data) {
+	const int64_t count = p_times.size();
+	if (p_channels.size() != count || p_types.size() != count || p_data.size() != count) {
+		UtilityFunctions::push_error("MidiSequence: append_events() arrays must all have the same size.");
+		return;
+	}
+	batch.clear();
+	batch.reserve((size_t)count);
+	for (int64_t i = 0; i < count; i++) {
+		if (!(p_times[i] >= 0.0)) {
+			UtilityFunctions::push_error("MidiSequence: append_events() times must not be negative.");
+			return;
+		}
+		tml_message msg = {};
+		msg.time = sequence_time_ms(p_times[i]);
+		msg.channel = p_channels[i] & 0x0F;
+		const int data = p_data[i];
+		const int a = data & 0x7F;
+		const int b = (data >> 8) & 0x7F;
+		switch (p_types[i]) {
+			case EVENT_NOTE_ON:
+			case EVENT_NOTE_OFF:
+				// Same convention as tml_load_memory(): a velocity 0 note-on is a note-off.
+				msg.type = (p_types[i] == EVENT_NOTE_ON && b > 0) ? TML_NOTE_ON : TML_NOTE_OFF;
+				msg.key = (char)a;
+				msg.velocity = (char)b;
+				break;
+			case EVENT_KEY_PRESSURE:
+				msg.type = TML_KEY_PRESSURE;
+				msg.key = (char)a;
+				msg.key_pressure = (char)b;
+				break;
+			case EVENT_CONTROL_CHANGE:
+				msg.type = TML_CONTROL_CHANGE;
+				msg.control = (char)a;
+				msg.control_value = (char)b;
+				break;
+			case EVENT_PROGRAM_CHANGE:
+				msg.type = TML_PROGRAM_CHANGE;
+				msg.program = (char)a;
+				break;
+			case EVENT_CHANNEL_PRESSURE:
+				msg.type = TML_CHANNEL_PRESSURE;
+				msg.channel_pressure = (char)a;
+				break;
+			case EVENT_PITCH_BEND:
+				msg.type = TML_PITCH_BEND;
+				msg.pitch_bend = (unsigned short)(data < 0 ? 0 : (data > 16383 ? 16383 : data));
+				break;
+			default:
+				UtilityFunctions::push_error("MidiSequence: append_events() got an unknown event type: " + String::num_int64(p_types[i]));
+				return;
+		}
+		batch.push_back(msg);
+	}
+	events.insert(batch.data(), (int)batch.size());
+}
+
+void MidiSequence::append_notes(const PackedFloat64Array &p_times, const PackedByteArray &p_channels, const PackedByteArray &p_keys, const PackedByteArray &p_velocities, const PackedFloat64Array &p_durations) {
+	const int64_t count = p_times.size();
+	if (p_channels.size() != count || p_keys.size() != count || p_velocities.size() != count || p_durations.size() != count) {
+		UtilityFunctions::push_error("MidiSequence: append_notes() arrays must all have the same size.");
+		return;
+	}
+	batch.clear();
+	batch.reserve((size_t)count * 2);
+	for (int64_t i = 0; i < count; i++) {
+		if (!(p_times[i] >= 0.0) || !(p_durations[i] >= 0.0)) {
+			UtilityFunctions::push_error("MidiSequence: append_notes() times and durations must not be negative.");
+			return;
+		}
+		tml_message on = {};
+		on.time = sequence_time_ms(p_times[i]);
+		on.type = p_velocities[i] > 0 ? TML_NOTE_ON : TML_NOTE_OFF;
+		on.channel = p_channels[i] & 0x0F;
+		on.key = (char)(p_keys[i] & 0x7F);
+		on.velocity = (char)(p_velocities[i] & 0x7F);
+		batch.push_back(on);
+
+		tml_message off = on;
+		off.time = sequence_time_ms(p_times[i] + p_durations[i]);
+		off.type = TML_NOTE_OFF;
+		off.velocity = 0;
+		batch.push_back(off);
+	}
+	events.insert(batch.data(), (int)batch.size());
+}
+
+void MidiSequence::clear() {
+	events.clear();
+}
+
+int MidiSequence::get_event_count() const {
+	return events.size();
+}
+
+double MidiSequence::get_length_seconds() const {
+	return (double)events.get_end_ms() / 1000.0;
+}
+
+void MidiSequence::set_complete(bool p_complete) {
+	complete = p_complete;
+}
+
+bool MidiSequence::is_complete() const {
+	return complete;
+}
+
 } // namespace godot
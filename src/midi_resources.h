@@ -1,10 +1,16 @@
 #pragma once
 
+#include <vector>
+
 #include <godot_cpp/classes/resource.hpp>
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float64_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
 #include <godot_cpp/variant/string.hpp>
 
+#include "midi_event_list.h"
+
 namespace godot {
 
 class MidiFileResource : public Resource {
@@ -35,4 +41,49 @@ private:
 	PackedByteArray data;
 };
 
+// Event sequence built from script, played by MidiPlayer without going through
+// SMF bytes. Events can be appended while players are playing it; each is
+// heard if it lands after the last event a player has already applied.
+class MidiSequence : public Resource {
+	GDCLASS(MidiSequence, Resource)
+
+public:
+	enum EventType {
+		EVENT_NOTE_OFF = 0x80,
+		EVENT_NOTE_ON = 0x90,
+		EVENT_KEY_PRESSURE = 0xA0,
+		EVENT_CONTROL_CHANGE = 0xB0,
+		EVENT_PROGRAM_CHANGE = 0xC0,
+		EVENT_CHANNEL_PRESSURE = 0xD0,
+		EVENT_PITCH_BEND = 0xE0,
+	};
+
+	// Parallel arrays, one entry per event, in any order. p_data packs the message
+	// bytes: key | velocity << 8 for notes, controller | value << 8, program,
+	// pressure (key | pressure << 8 for key pressure) or a 0-16383 pitch bend.
+	void append_events(const PackedFloat64Array &p_times, const PackedByteArray &p_channels, const PackedByteArray &p_types, const PackedInt32Array &p_data);
+	// Adds a note-on and a note-off p_durations seconds later for each entry.
+	void append_notes(const PackedFloat64Array &p_times, const PackedByteArray &p_channels, const PackedByteArray &p_keys, const PackedByteArray &p_velocities, const PackedFloat64Array &p_durations);
+	void clear();
+
+	int get_event_count() const;
+	double get_length_seconds() const;
+	// While false, players that reach the last event wait for more instead of
+	// stopping or looping.
+	void set_complete(bool p_complete);
+	bool is_complete() const;
+
+	const MidiEventList &get_events() const { return events; }
+
+protected:
+	static void _bind_methods();
+
+private:
+	MidiEventList events;
+	std::vector<tml_message> batch; // reused between appends
+	bool complete = false;
+};
+
 } // namespace godot
+
+VARIANT_ENUM_CAST(MidiSequence::EventType);
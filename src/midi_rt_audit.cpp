@@ -0,0 +1,250 @@
+#include "midi_rt_audit.h"
+
+#ifdef MIDI_RT_AUDIT
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MIDI_RT_CALLER() _ReturnAddress()
+#else
+#define MIDI_RT_CALLER() __builtin_return_address(0)
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+#if defined(__linux__)
+#include <fcntl.h>
+#include <pthread.h>
+#include <cstdarg>
+#endif
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+namespace godot {
+
+static thread_local int rt_scope_depth = 0;
+static thread_local const char *rt_scope_name = nullptr;
+static thread_local bool rt_reporting = false;
+
+// Reports live in fixed storage: recording one must not allocate either.
+static constexpr int k_max_reports = 64;
+static constexpr int k_max_sites = 256;
+
+struct RtReport {
+	std::atomic<bool> ready{ false };
+	char text[256];
+};
+static RtReport rt_reports[k_max_reports];
+static std::atomic<int> rt_report_count{ 0 };
+static int rt_reports_flushed = 0; // main thread only
+static std::atomic<void *> rt_seen_sites[k_max_sites];
+
+// Each call site is reported once, so a violation inside a loop doesn't flood the log.
+static bool rt_first_report(void *p_site) {
+	for (int i = 0; i < k_max_sites; i++) {
+		void *current = rt_seen_sites[i].load();
+		if (current == p_site) {
+			return false;
+		}
+		if (!current) {
+			void *expected = nullptr;
+			if (rt_seen_sites[i].compare_exchange_strong(expected, p_site)) {
+				return true;
+			}
+			if (expected == p_site) {
+				return false;
+			}
+		}
+	}
+	return false;
+}
+
+MidiRtAuditScope::MidiRtAuditScope(const char *p_name) {
+	if (rt_scope_depth++ == 0) {
+		rt_scope_name = p_name;
+	}
+}
+
+MidiRtAuditScope::~MidiRtAuditScope() {
+	if (--rt_scope_depth == 0) {
+		rt_scope_name = nullptr;
+	}
+}
+
+void midi_rt_audit_violation(const char *p_kind, void *p_call_site) {
+	if (rt_scope_depth == 0 || rt_reporting) {
+		return;
+	}
+	rt_reporting = true;
+	if (rt_first_report(p_call_site)) {
+		const int index = rt_report_count.fetch_add(1);
+		if (index < k_max_reports) {
+			RtReport &report = rt_reports[index];
+			const char *symbol = nullptr;
+			size_t offset = 0;
+#if defined(__linux__) || defined(__APPLE__)
+			Dl_info info;
+			if (dladdr(p_call_site, &info) && info.dli_sname) {
+				symbol = info.dli_sname;
+				offset = (size_t)((const char *)p_call_site - (const char *)info.dli_saddr);
+			}
+#endif
+			if (symbol) {
+				snprintf(report.text, sizeof(report.text), "%s in %s, called from %s+0x%zx", p_kind, rt_scope_name, symbol, offset);
+			} else {
+				snprintf(report.text, sizeof(report.text), "%s in %s, called from %p", p_kind, rt_scope_name, p_call_site);
+			}
+			report.ready.store(true);
+		}
+	}
+	rt_reporting = false;
+}
+
+void midi_rt_audit_flush() {
+	const int count = rt_report_count.load();
+	while (rt_reports_flushed < count && rt_reports_flushed < k_max_reports && rt_reports[rt_reports_flushed].ready.load()) {
+		UtilityFunctions::push_warning(String("MidiPlayer: real-time violation: ") + rt_reports[rt_reports_flushed].text);
+		rt_reports_flushed++;
+	}
+	if (rt_reports_flushed == k_max_reports && count > k_max_reports) {
+		UtilityFunctions::push_warning("MidiPlayer: real-time audit report limit reached; further violations are not shown.");
+		rt_reports_flushed++;
+	}
+}
+
+} // namespace godot
+
+extern "C" void *midi_rt_audit_malloc(size_t p_size) {
+	godot::midi_rt_audit_violation("malloc", MIDI_RT_CALLER());
+	return malloc(p_size);
+}
+
+extern "C" void *midi_rt_audit_realloc(void *p_ptr, size_t p_size) {
+	godot::midi_rt_audit_violation("realloc", MIDI_RT_CALLER());
+	return realloc(p_ptr, p_size);
+}
+
+extern "C" void midi_rt_audit_free(void *p_ptr) {
+	if (p_ptr) {
+		godot::midi_rt_audit_violation("free", MIDI_RT_CALLER());
+	}
+	free(p_ptr);
+}
+
+// Replacement global allocation functions. Each library binds its own
+// (-Bsymbolic on Linux, see SConstruct), so only this extension is audited.
+static void *midi_rt_new(size_t p_size, void *p_caller) {
+	godot::midi_rt_audit_violation("operator new", p_caller);
+	void *ptr = malloc(p_size ? p_size : 1);
+	if (!ptr) {
+		abort();
+	}
+	return ptr;
+}
+
+static void midi_rt_delete(void *p_ptr, void *p_caller) {
+	if (p_ptr) {
+		godot::midi_rt_audit_violation("operator delete", p_caller);
+	}
+	free(p_ptr);
+}
+
+void *operator new(size_t p_size) {
+	return midi_rt_new(p_size, MIDI_RT_CALLER());
+}
+void *operator new[](size_t p_size) {
+	return midi_rt_new(p_size, MIDI_RT_CALLER());
+}
+void *operator new(size_t p_size, const std::nothrow_t &) noexcept {
+	godot::midi_rt_audit_violation("operator new", MIDI_RT_CALLER());
+	return malloc(p_size ? p_size : 1);
+}
+void *operator new[](size_t p_size, const std::nothrow_t &) noexcept {
+	godot::midi_rt_audit_violation("operator new", MIDI_RT_CALLER());
+	return malloc(p_size ? p_size : 1);
+}
+void operator delete(void *p_ptr) noexcept {
+	midi_rt_delete(p_ptr, MIDI_RT_CALLER());
+}
+void operator delete[](void *p_ptr) noexcept {
+	midi_rt_delete(p_ptr, MIDI_RT_CALLER());
+}
+void operator delete(void *p_ptr, size_t) noexcept {
+	midi_rt_delete(p_ptr, MIDI_RT_CALLER());
+}
+void operator delete[](void *p_ptr, size_t) noexcept {
+	midi_rt_delete(p_ptr, MIDI_RT_CALLER());
+}
+
+#if defined(__linux__)
+// Locks and file I/O are trapped by shadowing the libc entry points inside this
+// library and forwarding to the real ones.
+template <typename T>
+static T midi_rt_next(T &r_cache, const char *p_name) {
+	if (!r_cache) {
+		r_cache = (T)dlsym(RTLD_NEXT, p_name);
+	}
+	return r_cache;
+}
+
+static int (*real_pthread_mutex_lock)(pthread_mutex_t *) = nullptr;
+static int (*real_pthread_mutex_trylock)(pthread_mutex_t *) = nullptr;
+static FILE *(*real_fopen)(const char *, const char *) = nullptr;
+static size_t (*real_fread)(void *, size_t, size_t, FILE *) = nullptr;
+static size_t (*real_fwrite)(const void *, size_t, size_t, FILE *) = nullptr;
+static int (*real_open)(const char *, int, ...) = nullptr;
+
+// Resolve up front: dlsym() itself must not run inside a hook on the audio thread.
+__attribute__((constructor)) static void midi_rt_resolve_hooks() {
+	midi_rt_next(real_pthread_mutex_lock, "pthread_mutex_lock");
+	midi_rt_next(real_pthread_mutex_trylock, "pthread_mutex_trylock");
+	midi_rt_next(real_fopen, "fopen");
+	midi_rt_next(real_fread, "fread");
+	midi_rt_next(real_fwrite, "fwrite");
+	midi_rt_next(real_open, "open");
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t *p_mutex) {
+	godot::midi_rt_audit_violation("mutex lock", MIDI_RT_CALLER());
+	return midi_rt_next(real_pthread_mutex_lock, "pthread_mutex_lock")(p_mutex);
+}
+
+extern "C" int pthread_mutex_trylock(pthread_mutex_t *p_mutex) {
+	godot::midi_rt_audit_violation("mutex lock", MIDI_RT_CALLER());
+	return midi_rt_next(real_pthread_mutex_trylock, "pthread_mutex_trylock")(p_mutex);
+}
+
+extern "C" FILE *fopen(const char *p_path, const char *p_mode) {
+	godot::midi_rt_audit_violation("file open", MIDI_RT_CALLER());
+	return midi_rt_next(real_fopen, "fopen")(p_path, p_mode);
+}
+
+extern "C" size_t fread(void *p_buffer, size_t p_size, size_t p_count, FILE *p_file) {
+	godot::midi_rt_audit_violation("file read", MIDI_RT_CALLER());
+	return midi_rt_next(real_fread, "fread")(p_buffer, p_size, p_count, p_file);
+}
+
+extern "C" size_t fwrite(const void *p_buffer, size_t p_size, size_t p_count, FILE *p_file) {
+	godot::midi_rt_audit_violation("file write", MIDI_RT_CALLER());
+	return midi_rt_next(real_fwrite, "fwrite")(p_buffer, p_size, p_count, p_file);
+}
+
+extern "C" int open(const char *p_path, int p_flags, ...) {
+	godot::midi_rt_audit_violation("file open", MIDI_RT_CALLER());
+	int mode = 0;
+	if (p_flags & O_CREAT) {
+		va_list args;
+		va_start(args, p_flags);
+		mode = va_arg(args, int);
+		va_end(args);
+	}
+	return midi_rt_next(real_open, "open")(p_path, p_flags, mode);
+}
+#endif
+
+#endif // MIDI_RT_AUDIT
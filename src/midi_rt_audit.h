@@ -0,0 +1,41 @@
+#pragma once
+
+// Real-time-safety audit, enabled with `scons rt_audit=yes` (defines MIDI_RT_AUDIT).
+// Code inside MIDI_RT_SCOPE must not allocate, free, lock or open/read/write
+// files. In audit builds the hooks in midi_rt_audit.cpp record each offending
+// call site once; MIDI_RT_AUDIT_FLUSH() reports them through push_warning()
+// from the main thread. In normal builds both macros expand to nothing.
+
+#ifdef MIDI_RT_AUDIT
+
+#include <cstddef>
+
+namespace godot {
+
+class MidiRtAuditScope {
+public:
+	explicit MidiRtAuditScope(const char *p_name);
+	~MidiRtAuditScope();
+};
+
+// Called by the hooks from any thread. Does nothing outside a scope.
+void midi_rt_audit_violation(const char *p_kind, void *p_call_site);
+// Call from the main thread, outside any scope.
+void midi_rt_audit_flush();
+
+} // namespace godot
+
+// TinySoundFont/TinyMidiLoader allocate through these in audit builds.
+extern "C" void *midi_rt_audit_malloc(size_t p_size);
+extern "C" void *midi_rt_audit_realloc(void *p_ptr, size_t p_size);
+extern "C" void midi_rt_audit_free(void *p_ptr);
+
+#define MIDI_RT_SCOPE(m_name) ::godot::MidiRtAuditScope _midi_rt_scope(m_name)
+#define MIDI_RT_AUDIT_FLUSH() ::godot::midi_rt_audit_flush()
+
+#else
+
+#define MIDI_RT_SCOPE(m_name)
+#define MIDI_RT_AUDIT_FLUSH()
+
+#endif
@@ -0,0 +1,144 @@
+#include "midi_send_effects.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace godot {
+
+// Line lengths at 44.1 kHz (Freeverb's comb lengths), scaled to the mix rate.
+static constexpr int k_reverb_line_lengths[MidiReverb::k_lines] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+static constexpr float k_reverb_input_gain = 0.25f;
+static constexpr float k_reverb_output_gain = 0.5f;
+static constexpr float k_chorus_base_delay_ms = 12.0f;
+static constexpr float k_chorus_max_depth_ms = 10.0f;
+
+void MidiReverb::configure(int p_sample_rate) {
+	const double scale = (double)std::max(8000, p_sample_rate) / 44100.0;
+	for (int i = 0; i < k_lines; i++) {
+		lines[i].assign((size_t)std::max(1, (int)(k_reverb_line_lengths[i] * scale)), 0.0f);
+	}
+	reset();
+}
+
+void MidiReverb::reset() {
+	for (int i = 0; i < k_lines; i++) {
+		std::fill(lines[i].begin(), lines[i].end(), 0.0f);
+		positions[i] = 0;
+		lowpass[i] = 0.0f;
+	}
+}
+
+void MidiReverb::set_room_size(float p_room_size) {
+	// The Hadamard mix is orthonormal, so any feedback below 1 is stable.
+	feedback = 0.7f + 0.28f * std::max(0.0f, std::min(1.0f, p_room_size));
+}
+
+void MidiReverb::set_damping(float p_damping) {
+	damping = 0.05f + 0.9f * std::max(0.0f, std::min(1.0f, p_damping));
+}
+
+void MidiReverb::process(const float *p_input, float *r_output, int p_frames, float p_level) {
+	if (lines[0].empty()) {
+		return;
+	}
+	const float out_gain = k_reverb_output_gain * p_level;
+	for (int f = 0; f < p_frames; f++) {
+		const float in = (p_input[f * 2] + p_input[f * 2 + 1]) * (0.5f * k_reverb_input_gain);
+
+		float y[k_lines];
+		for (int i = 0; i < k_lines; i++) {
+			y[i] = lines[i][positions[i]];
+		}
+		float h[k_lines];
+		for (int i = 0; i < k_lines; i++) {
+			lowpass[i] = y[i] + (lowpass[i] - y[i]) * damping;
+			h[i] = lowpass[i];
+		}
+		// Fast Walsh-Hadamard transform, normalized by 1/sqrt(8).
+		for (int span = 1; span < k_lines; span *= 2) {
+			for (int i = 0; i < k_lines; i += span * 2) {
+				for (int j = i; j < i + span; j++) {
+					const float a = h[j];
+					const float b = h[j + span];
+					h[j] = a + b;
+					h[j + span] = a - b;
+				}
+			}
+		}
+		const float mix = feedback * 0.35355339f;
+		for (int i = 0; i < k_lines; i++) {
+			// Alternating input signs decorrelate the two output sums.
+			lines[i][positions[i]] = ((i & 1) ? -in : in) + h[i] * mix;
+			if (++positions[i] >= (int)lines[i].size()) {
+				positions[i] = 0;
+			}
+		}
+		r_output[f * 2] += (y[0] + y[2] + y[4] + y[6]) * out_gain;
+		r_output[f * 2 + 1] += (y[1] + y[3] + y[5] + y[7]) * out_gain;
+	}
+}
+
+void MidiChorus::configure(int p_sample_rate) {
+	sample_rate = std::max(8000, p_sample_rate);
+	delay_frames = (int)((k_chorus_base_delay_ms + k_chorus_max_depth_ms) * 0.001f * sample_rate) + 4;
+	delay.assign((size_t)delay_frames * 2, 0.0f);
+	set_depth_ms(depth_ms);
+	set_rate_hz(rate_hz);
+	reset();
+}
+
+void MidiChorus::reset() {
+	std::fill(delay.begin(), delay.end(), 0.0f);
+	write_pos = 0;
+	lfo_cos = 1.0f;
+	lfo_sin = 0.0f;
+}
+
+void MidiChorus::set_depth_ms(float p_depth_ms) {
+	depth_ms = std::max(0.0f, std::min(k_chorus_max_depth_ms, p_depth_ms));
+	base_delay = k_chorus_base_delay_ms * 0.001f * sample_rate;
+	depth = depth_ms * 0.001f * sample_rate;
+}
+
+void MidiChorus::set_rate_hz(float p_rate_hz) {
+	rate_hz = std::max(0.01f, std::min(10.0f, p_rate_hz));
+	const double step = 2.0 * 3.14159265358979323846 * rate_hz / sample_rate;
+	lfo_step_cos = (float)std::cos(step);
+	lfo_step_sin = (float)std::sin(step);
+}
+
+void MidiChorus::process(const float *p_input, float *r_output, int p_frames, float p_level) {
+	if (delay.empty()) {
+		return;
+	}
+	for (int f = 0; f < p_frames; f++) {
+		delay[write_pos * 2] = p_input[f * 2];
+		delay[write_pos * 2 + 1] = p_input[f * 2 + 1];
+
+		const float lfo[2] = { lfo_sin, lfo_cos };
+		for (int side = 0; side < 2; side++) {
+			const float d = base_delay + depth * (0.5f + 0.5f * lfo[side]);
+			float read = (float)write_pos - d;
+			if (read < 0.0f) {
+				read += (float)delay_frames;
+			}
+			const int i0 = (int)read;
+			const float alpha = read - (float)i0;
+			const int i1 = i0 + 1 < delay_frames ? i0 + 1 : 0;
+			r_output[f * 2 + side] += (delay[i0 * 2 + side] * (1.0f - alpha) + delay[i1 * 2 + side] * alpha) * p_level;
+		}
+
+		const float c = lfo_cos * lfo_step_cos - lfo_sin * lfo_step_sin;
+		lfo_sin = lfo_sin * lfo_step_cos + lfo_cos * lfo_step_sin;
+		lfo_cos = c;
+		if (++write_pos >= delay_frames) {
+			write_pos = 0;
+			// Keep the phasor on the unit circle despite rounding.
+			const float norm = 1.0f / std::sqrt(lfo_cos * lfo_cos + lfo_sin * lfo_sin);
+			lfo_cos *= norm;
+			lfo_sin *= norm;
+		}
+	}
+}
+
+} // namespace godot
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+namespace godot {
+
+// Send effects shared by every player on a bus (see MidiEffectBuses). Both take
+// a stereo interleaved send signal and add their wet output to r_output. They
+// are independent of Godot and allocate only in configure().
+
+// Eight-line feedback delay network: the lines are mixed through a Hadamard
+// matrix and damped with one-pole lowpasses.
+class MidiReverb {
+public:
+	static constexpr int k_lines = 8;
+
+	void configure(int p_sample_rate);
+	void reset();
+	// 0..1: decay time from short room to long hall.
+	void set_room_size(float p_room_size);
+	// 0..1: how fast high frequencies die away.
+	void set_damping(float p_damping);
+	void process(const float *p_input, float *r_output, int p_frames, float p_level);
+
+private:
+	std::vector<float> lines[k_lines];
+	int positions[k_lines] = {};
+	float lowpass[k_lines] = {};
+	float feedback = 0.84f;
+	float damping = 0.3f;
+};
+
+// Stereo chorus: one modulated delay per side, the LFOs a quarter cycle apart.
+class MidiChorus {
+public:
+	void configure(int p_sample_rate);
+	void reset();
+	void set_depth_ms(float p_depth_ms);
+	void set_rate_hz(float p_rate_hz);
+	void process(const float *p_input, float *r_output, int p_frames, float p_level);
+
+private:
+	std::vector<float> delay; // stereo interleaved ring
+	int delay_frames = 0;
+	int write_pos = 0;
+	int sample_rate = 44100;
+	float base_delay = 0.0f; // samples
+	float depth = 0.0f; // samples
+	float depth_ms = 4.0f;
+	float rate_hz = 0.8f;
+	// LFO as a rotating phasor: (lfo_cos, lfo_sin) advances by lfo_step each sample.
+	float lfo_cos = 1.0f;
+	float lfo_sin = 0.0f;
+	float lfo_step_cos = 1.0f;
+	float lfo_step_sin = 0.0f;
+};
+
+} // namespace godot
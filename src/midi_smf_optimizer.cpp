@@ -0,0 +1,387 @@
+#include "midi_smf_optimizer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace godot {
+
+namespace {
+
+constexpr double k_default_usec_per_beat = 500000.0;
+
+uint32_t read_be(const uint8_t *p_data, int p_bytes) {
+	uint32_t value = 0;
+	for (int i = 0; i < p_bytes; i++) {
+		value = (value << 8) | p_data[i];
+	}
+	return value;
+}
+
+bool read_vlq(const uint8_t *&r_pos, const uint8_t *p_end, uint32_t &r_value) {
+	r_value = 0;
+	for (int i = 0; i < 4; i++) {
+		if (r_pos >= p_end) {
+			return false;
+		}
+		const uint8_t byte = *r_pos++;
+		r_value = (r_value << 7) | (byte & 0x7F);
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void write_vlq(std::vector<uint8_t> &r_out, uint32_t p_value) {
+	uint8_t bytes[5];
+	int count = 0;
+	bytes[count++] = p_value & 0x7F;
+	while (p_value >>= 7) {
+		bytes[count++] = (uint8_t)((p_value & 0x7F) | 0x80);
+	}
+	while (count > 0) {
+		r_out.push_back(bytes[--count]);
+	}
+}
+
+void write_be(std::vector<uint8_t> &r_out, uint32_t p_value, int p_bytes) {
+	for (int i = p_bytes - 1; i >= 0; i--) {
+		r_out.push_back((uint8_t)(p_value >> (i * 8)));
+	}
+}
+
+struct Event {
+	uint64_t tick = 0;
+	double ms = 0.0;
+	const uint8_t *raw = nullptr; // meta and sysex: from the status byte to the end of the event
+	uint32_t raw_length = 0;
+	int track = 0;
+	uint8_t status = 0;
+	uint8_t a = 0;
+	uint8_t b = 0;
+	bool keep = true;
+};
+
+struct Track {
+	size_t first = 0;
+	size_t count = 0;
+	uint64_t end_tick = 0;
+};
+
+// One controller (or pitch bend, or channel pressure) of one channel.
+struct Stream {
+	int source = -1; // last value in the input
+	int kept = -1; // last value written out
+	double kept_ms = 0.0;
+	int pending = -1; // left-out event that is written after all if it ends a run
+	int pending_value = 0;
+	double pending_ms = 0.0;
+};
+
+struct ChannelState {
+	Stream controllers[128];
+	Stream bend;
+	Stream pressure;
+	int program = -1;
+	bool bank_changed = false;
+	uint16_t notes[128] = {};
+};
+
+// Data entry, (N)RPN and channel mode messages act on what comes before or after them.
+bool is_state_controller(int p_control) {
+	return p_control < 120 && p_control != 6 && p_control != 38 && !(p_control >= 96 && p_control <= 101);
+}
+
+// Switches (sustain, portamento, sostenuto, soft, legato, hold 2) act on a threshold,
+// so every change is kept where it is; only repeats are dropped.
+bool is_thinnable_controller(int p_control) {
+	return is_state_controller(p_control) && p_control != 0 && p_control != 32 && !(p_control >= 64 && p_control <= 69);
+}
+
+void keep_pending(std::vector<Event> &r_events, Stream &r_stream) {
+	if (r_stream.pending < 0) {
+		return;
+	}
+	r_events[r_stream.pending].keep = true;
+	r_stream.kept = r_stream.pending_value;
+	r_stream.kept_ms = r_stream.pending_ms;
+	r_stream.pending = -1;
+}
+
+// Decides whether an update to r_stream is written now, later (as the end of a run) or not at all.
+void update_stream(std::vector<Event> &r_events, int p_index, Stream &r_stream, int p_value, int p_tolerance, bool p_thinnable, const MidiOptimizeOptions &p_options) {
+	Event &event = r_events[p_index];
+	if (p_options.remove_redundant && p_value == r_stream.source) {
+		event.keep = false;
+		return;
+	}
+	r_stream.source = p_value;
+	const bool thinning = p_thinnable && (p_tolerance > 0 || p_options.min_interval_ms > 0.0);
+	if (!thinning || r_stream.kept < 0) {
+		r_stream.pending = -1;
+		r_stream.kept = p_value;
+		r_stream.kept_ms = event.ms;
+		return;
+	}
+	// A pending value that was held back only for timing is written if it then held for a while.
+	if (r_stream.pending >= 0 && std::abs(r_stream.pending_value - r_stream.kept) > p_tolerance && event.ms - r_stream.pending_ms >= p_options.min_interval_ms) {
+		keep_pending(r_events, r_stream);
+	}
+	const bool close = std::abs(p_value - r_stream.kept) <= p_tolerance || event.ms - r_stream.kept_ms < p_options.min_interval_ms;
+	if (!close) {
+		r_stream.pending = -1;
+		r_stream.kept = p_value;
+		r_stream.kept_ms = event.ms;
+		return;
+	}
+	event.keep = false;
+	r_stream.pending = p_index;
+	r_stream.pending_value = p_value;
+	r_stream.pending_ms = event.ms;
+}
+
+void keep_all_pending(std::vector<Event> &r_events, ChannelState &r_channel) {
+	for (Stream &stream : r_channel.controllers) {
+		keep_pending(r_events, stream);
+	}
+	keep_pending(r_events, r_channel.bend);
+	keep_pending(r_events, r_channel.pressure);
+}
+
+} // namespace
+
+bool midi_optimize_smf(const uint8_t *p_data, size_t p_size, const MidiOptimizeOptions &p_options, std::vector<uint8_t> &r_out, MidiOptimizeStats &r_stats) {
+	r_out.clear();
+	r_stats = MidiOptimizeStats();
+	if (!p_data || p_size < 14 || memcmp(p_data, "MThd", 4) != 0) {
+		return false;
+	}
+	const uint32_t header_length = read_be(p_data + 4, 4);
+	if (header_length < 6 || 8 + (size_t)header_length > p_size) {
+		return false;
+	}
+	const int track_count = (int)read_be(p_data + 10, 2);
+	const uint32_t raw_division = read_be(p_data + 12, 2);
+
+	std::vector<Event> events;
+	std::vector<Track> tracks;
+	size_t pos = 8 + header_length;
+	while (pos + 8 <= p_size && (int)tracks.size() < track_count) {
+		const uint32_t chunk_length = read_be(p_data + pos + 4, 4);
+		const size_t chunk_end = pos + 8 + (size_t)chunk_length;
+		if (memcmp(p_data + pos, "MTrk", 4) != 0) {
+			pos = chunk_end;
+			continue;
+		}
+		Track track;
+		track.first = events.size();
+		const uint8_t *cursor = p_data + pos + 8;
+		const uint8_t *end = p_data + std::min(chunk_end, p_size);
+		uint64_t tick = 0;
+		uint8_t running_status = 0;
+		uint32_t delta = 0;
+		// Truncated or corrupt tracks keep what was readable, like tml_load_memory().
+		while (read_vlq(cursor, end, delta)) {
+			tick += delta;
+			if (cursor >= end) {
+				break;
+			}
+			const uint8_t *start = cursor;
+			uint8_t status = *cursor;
+			if (status & 0x80) {
+				cursor++;
+			} else {
+				status = running_status;
+			}
+
+			Event event;
+			event.tick = tick;
+			event.track = (int)tracks.size();
+			event.status = status;
+			if (status >= 0x80 && status < 0xF0) {
+				running_status = status;
+				const int data_bytes = (status & 0xE0) == 0xC0 ? 1 : 2;
+				if (end - cursor < data_bytes) {
+					break;
+				}
+				event.a = cursor[0] & 0x7F;
+				event.b = data_bytes == 2 ? cursor[1] & 0x7F : 0;
+				cursor += data_bytes;
+			} else if (status == 0xF0 || status == 0xF7 || status == 0xFF) {
+				if (status == 0xFF && cursor++ >= end) {
+					break;
+				}
+				uint32_t length = 0;
+				if (!read_vlq(cursor, end, length) || (size_t)(end - cursor) < length) {
+					break;
+				}
+				cursor += length;
+				if (status == 0xFF && start[1] == 0x2F) {
+					break;
+				}
+				event.raw = start;
+				event.raw_length = (uint32_t)(cursor - start);
+			} else {
+				break;
+			}
+			events.push_back(event);
+		}
+		track.count = events.size() - track.first;
+		track.end_tick = track.count > 0 ? std::max(tick, events.back().tick) : tick;
+		tracks.push_back(track);
+		pos = chunk_end;
+	}
+	if (tracks.empty()) {
+		return false;
+	}
+
+	// Merged playback order: by tick, then track, then position in the track.
+	std::vector<int> order(events.size());
+	for (int i = 0; i < (int)order.size(); i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int p_a, int p_b) { return events[p_a].tick < events[p_b].tick; });
+
+	const bool smpte = (raw_division & 0x8000) != 0;
+	const double ticks_per_second = smpte ? (double)(256 - (int)(raw_division >> 8)) * (double)(raw_division & 0xFF) : 0.0;
+	const int division = raw_division ? (int)raw_division : 480;
+	double ms_per_tick = smpte ? (ticks_per_second > 0.0 ? 1000.0 / ticks_per_second : 0.0) : k_default_usec_per_beat / (1000.0 * division);
+	double tempo_ms = 0.0;
+	uint64_t tempo_tick = 0;
+	int64_t current_tempo = -1;
+
+	std::vector<ChannelState> channels(16);
+	for (int index : order) {
+		Event &event = events[index];
+		event.ms = tempo_ms + (double)(event.tick - tempo_tick) * ms_per_tick;
+		if (event.status == 0xFF) {
+			const uint8_t *meta = event.raw + 1;
+			const uint8_t *body = meta + 1;
+			uint32_t length = 0;
+			if (*meta == 0x51 && read_vlq(body, event.raw + event.raw_length, length) && length == 3) {
+				const uint32_t usec_per_beat = read_be(body, 3);
+				if (p_options.remove_redundant && (int64_t)usec_per_beat == current_tempo) {
+					event.keep = false;
+				} else if (usec_per_beat > 0 && !smpte) {
+					current_tempo = usec_per_beat;
+					tempo_ms = event.ms;
+					tempo_tick = event.tick;
+					ms_per_tick = (double)usec_per_beat / (1000.0 * division);
+				}
+			}
+			continue;
+		}
+		if (event.status >= 0xF0) {
+			continue;
+		}
+
+		ChannelState &channel = channels[event.status & 0x0F];
+		switch (event.status & 0xF0) {
+			case 0x90:
+				if (event.b > 0) {
+					if (channel.notes[event.a] < UINT16_MAX) {
+						channel.notes[event.a]++;
+					}
+					break;
+				}
+				[[fallthrough]];
+			case 0x80:
+				if (channel.notes[event.a] > 0) {
+					channel.notes[event.a]--;
+				} else if (p_options.remove_redundant) {
+					event.keep = false;
+				}
+				break;
+			case 0xB0:
+				if (event.a == 121) {
+					// Reset all controllers: whatever was pending held until here.
+					keep_all_pending(events, channel);
+					for (Stream &stream : channel.controllers) {
+						stream = Stream();
+					}
+					channel.bend = Stream();
+					channel.pressure = Stream();
+				} else if (event.a == 120 || event.a >= 123) {
+					memset(channel.notes, 0, sizeof(channel.notes));
+				} else if (is_state_controller(event.a)) {
+					update_stream(events, index, channel.controllers[event.a], event.b, p_options.controller_tolerance, is_thinnable_controller(event.a), p_options);
+					if ((event.a == 0 || event.a == 32) && event.keep) {
+						channel.bank_changed = true;
+					}
+				}
+				break;
+			case 0xC0:
+				if (p_options.remove_redundant && event.a == channel.program && !channel.bank_changed) {
+					event.keep = false;
+				} else {
+					channel.program = event.a;
+					channel.bank_changed = false;
+				}
+				break;
+			case 0xD0:
+				update_stream(events, index, channel.pressure, event.a, p_options.controller_tolerance, true, p_options);
+				break;
+			case 0xE0:
+				update_stream(events, index, channel.bend, event.a | (event.b << 7), p_options.pitch_bend_tolerance, true, p_options);
+				break;
+		}
+	}
+	// The last value of every run is written, so controllers end where the source leaves them.
+	for (int c = 0; c < 16; c++) {
+		keep_all_pending(events, channels[c]);
+	}
+
+	r_out.reserve(p_size);
+	const uint8_t header[4] = { 'M', 'T', 'h', 'd' };
+	r_out.insert(r_out.end(), header, header + 4);
+	write_be(r_out, 6, 4);
+	r_out.push_back(p_data[8]);
+	r_out.push_back(p_data[9]);
+	write_be(r_out, (uint32_t)tracks.size(), 2);
+	write_be(r_out, raw_division, 2);
+	for (const Track &track : tracks) {
+		const uint8_t chunk[4] = { 'M', 'T', 'r', 'k' };
+		r_out.insert(r_out.end(), chunk, chunk + 4);
+		const size_t length_at = r_out.size();
+		write_be(r_out, 0, 4);
+		uint64_t last_tick = 0;
+		uint8_t running_status = 0;
+		for (size_t i = track.first; i < track.first + track.count; i++) {
+			const Event &event = events[i];
+			if (!event.keep) {
+				continue;
+			}
+			write_vlq(r_out, (uint32_t)(event.tick - last_tick));
+			last_tick = event.tick;
+			r_stats.events_after++;
+			if (event.raw) {
+				r_out.insert(r_out.end(), event.raw, event.raw + event.raw_length);
+				running_status = 0;
+				continue;
+			}
+			if (event.status != running_status) {
+				r_out.push_back(event.status);
+				running_status = event.status;
+			}
+			r_out.push_back(event.a);
+			if ((event.status & 0xE0) != 0xC0) {
+				r_out.push_back(event.b);
+			}
+		}
+		write_vlq(r_out, (uint32_t)(track.end_tick - last_tick));
+		const uint8_t end_of_track[3] = { 0xFF, 0x2F, 0x00 };
+		r_out.insert(r_out.end(), end_of_track, end_of_track + 3);
+		const uint32_t length = (uint32_t)(r_out.size() - length_at - 4);
+		for (int i = 0; i < 4; i++) {
+			r_out[length_at + i] = (uint8_t)(length >> ((3 - i) * 8));
+		}
+	}
+
+	r_stats.events_before = (int64_t)events.size();
+	r_stats.bytes_before = (int64_t)p_size;
+	r_stats.bytes_after = (int64_t)r_out.size();
+	return true;
+}
+
+} // namespace godot
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+struct MidiOptimizeOptions {
+	// Drops events that change nothing: repeated controller, pitch-bend, channel
+	// pressure, program and tempo values, and note-offs for notes that are not sounding.
+	bool remove_redundant = true;
+	// Continuous controllers (pitch bend, channel pressure and CCs other than bank
+	// select, the CC64-69 switches, data entry, (N)RPN and channel mode) are
+	// thinned: an update is left out while it stays within the tolerance of the
+	// last one kept, or arrives sooner than min_interval_ms after it. The last
+	// value of every run is kept at its original time, so controllers always
+	// settle where the source does.
+	int controller_tolerance = 1;
+	int pitch_bend_tolerance = 16; // 14-bit units; 8192 is the whole upward range
+	double min_interval_ms = 4.0;
+};
+
+struct MidiOptimizeStats {
+	int64_t events_before = 0;
+	int64_t events_after = 0;
+	int64_t bytes_before = 0;
+	int64_t bytes_after = 0;
+};
+
+// Rewrites a Standard MIDI File with the events the options allow to drop
+// removed; track layout, timing and meta/sysex events are preserved. Channel
+// messages are written with running status. Returns false if p_data is not an SMF.
+bool midi_optimize_smf(const uint8_t *p_data, size_t p_size, const MidiOptimizeOptions &p_options, std::vector<uint8_t> &r_out, MidiOptimizeStats &r_stats);
+
+} // namespace godot
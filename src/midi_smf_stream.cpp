@@ -0,0 +1,349 @@
+#include "midi_smf_stream.h"
+
+#include <cstring>
+
+namespace godot {
+
+namespace {
+
+uint32_t read_be(const uint8_t *p_data, int p_bytes) {
+	uint32_t value = 0;
+	for (int i = 0; i < p_bytes; i++) {
+		value = (value << 8) | p_data[i];
+	}
+	return value;
+}
+
+// Variable-length quantity; false if it runs past p_end.
+bool read_vlq(const uint8_t *&r_pos, const uint8_t *p_end, uint32_t &r_value) {
+	r_value = 0;
+	for (int i = 0; i < 4; i++) {
+		if (r_pos >= p_end) {
+			return false;
+		}
+		const uint8_t byte = *r_pos++;
+		r_value = (r_value << 7) | (byte & 0x7F);
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+constexpr double k_default_usec_per_beat = 500000.0;
+
+} // namespace
+
+bool MidiSmfStream::open(const uint8_t *p_data, size_t p_size) {
+	close();
+	if (!p_data || p_size < 14 || memcmp(p_data, "MThd", 4) != 0) {
+		return false;
+	}
+	const uint32_t header_length = read_be(p_data + 4, 4);
+	if (header_length < 6 || 8 + (size_t)header_length > p_size) {
+		return false;
+	}
+	const int track_count = (int)read_be(p_data + 10, 2);
+	const uint32_t raw_division = read_be(p_data + 12, 2);
+	if (raw_division & 0x8000) {
+		// SMPTE: negative frames per second in the high byte, ticks per frame in the low byte.
+		const int fps = 256 - (int)(raw_division >> 8);
+		ticks_per_second = (double)fps * (double)(raw_division & 0xFF);
+		if (ticks_per_second <= 0.0) {
+			return false;
+		}
+	} else {
+		division = raw_division ? (int)raw_division : 480;
+		ticks_per_second = 0.0;
+	}
+
+	tracks.clear();
+	tracks.reserve(track_count);
+	size_t pos = 8 + header_length;
+	while (pos + 8 <= p_size && (int)tracks.size() < track_count) {
+		const uint32_t chunk_length = read_be(p_data + pos + 4, 4);
+		const size_t chunk_end = pos + 8 + (size_t)chunk_length;
+		if (memcmp(p_data + pos, "MTrk", 4) == 0) {
+			Track track;
+			track.begin = p_data + pos + 8;
+			// Truncated files play up to where the data stops, like tml_load_memory().
+			track.end = p_data + (chunk_end < p_size ? chunk_end : p_size);
+			tracks.push_back(track);
+		}
+		pos = chunk_end;
+	}
+	if (tracks.empty()) {
+		return false;
+	}
+	heap.resize(tracks.size());
+	// Only streamed players pay for the ring.
+	ring.resize(k_ring_capacity);
+	tempo_log.resize(k_tempo_log_capacity);
+
+	data = p_data;
+	size = p_size;
+	rewind();
+	return true;
+}
+
+void MidiSmfStream::close() {
+	data = nullptr;
+	size = 0;
+	tracks.clear();
+	heap.clear();
+	heap_size = 0;
+	std::vector<tml_message>().swap(ring);
+	std::vector<TempoChange>().swap(tempo_log);
+	ring_head = 0;
+	ring_count = 0;
+	tempo_log_head = 0;
+	tempo_log_count = 0;
+	decoded_ms = 0;
+}
+
+void MidiSmfStream::rewind() {
+	ring_head = 0;
+	ring_count = 0;
+	tempo_log_head = 0;
+	tempo_log_count = 0;
+	decoded_ms = 0;
+	tempo_ms = 0.0;
+	tempo_tick = 0;
+	ms_per_tick = ticks_per_second > 0.0 ? 1000.0 / ticks_per_second : k_default_usec_per_beat / (1000.0 * division);
+
+	heap_size = 0;
+	for (int i = 0; i < (int)tracks.size(); i++) {
+		Track &track = tracks[i];
+		track.pos = track.begin;
+		track.next_tick = 0;
+		track.running_status = 0;
+		if (_read_delta(track)) {
+			heap[heap_size] = i;
+			_heap_sift_up(heap_size++);
+		}
+	}
+}
+
+bool MidiSmfStream::_read_delta(Track &r_track) {
+	uint32_t delta = 0;
+	if (!read_vlq(r_track.pos, r_track.end, delta)) {
+		return false;
+	}
+	r_track.next_tick += delta;
+	return true;
+}
+
+void MidiSmfStream::prefetch() {
+	while (ring_count < k_ring_capacity && tempo_log_count < k_tempo_log_capacity && _decode_one()) {
+	}
+}
+
+const tml_message *MidiSmfStream::peek(uint32_t p_time_ms) {
+	if (ring_count == 0 && !_decode_one()) {
+		return nullptr;
+	}
+	const tml_message *msg = &ring[ring_head];
+	return msg->time <= p_time_ms ? msg : nullptr;
+}
+
+void MidiSmfStream::pop() {
+	if (ring_count == 0) {
+		return;
+	}
+	ring_head = (ring_head + 1) % k_ring_capacity;
+	ring_count--;
+}
+
+bool MidiSmfStream::pop_tempo_change(uint32_t &r_time_ms, int &r_usec_per_beat) {
+	if (tempo_log_count == 0) {
+		return false;
+	}
+	const TempoChange &change = tempo_log[tempo_log_head];
+	r_time_ms = change.time_ms;
+	r_usec_per_beat = change.usec_per_beat;
+	tempo_log_head = (tempo_log_head + 1) % k_tempo_log_capacity;
+	tempo_log_count--;
+	return true;
+}
+
+void MidiSmfStream::_push_message(const tml_message &p_msg) {
+	ring[(ring_head + ring_count) % k_ring_capacity] = p_msg;
+	ring_count++;
+	decoded_ms = p_msg.time > decoded_ms ? p_msg.time : decoded_ms;
+}
+
+bool MidiSmfStream::_decode_one() {
+	// Skips events TinyMidiLoader drops (sysex, most meta) until one message is produced.
+	while (heap_size > 0 && ring_count < k_ring_capacity) {
+		const int track_index = heap[0];
+		Track &track = tracks[track_index];
+		const uint8_t *end = track.end;
+
+		const uint64_t tick = track.next_tick;
+		const double time_ms = tempo_ms + (double)(tick - tempo_tick) * ms_per_tick;
+
+		tml_message msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.time = (uint32_t)time_ms;
+		bool emit = false;
+		bool track_done = track.pos >= end;
+
+		if (!track_done) {
+			uint8_t status = *track.pos;
+			if (status & 0x80) {
+				track.pos++;
+			} else {
+				status = track.running_status;
+			}
+
+			if (status >= 0x80 && status < 0xF0) {
+				track.running_status = status;
+				const int data_bytes = (status & 0xE0) == 0xC0 ? 1 : 2;
+				if (end - track.pos < data_bytes) {
+					track_done = true;
+				} else {
+					const uint8_t a = track.pos[0] & 0x7F;
+					const uint8_t b = data_bytes == 2 ? track.pos[1] & 0x7F : 0;
+					track.pos += data_bytes;
+					msg.type = status & 0xF0;
+					msg.channel = status & 0x0F;
+					switch (msg.type) {
+						case TML_NOTE_ON:
+						case TML_NOTE_OFF:
+							msg.key = (char)a;
+							msg.velocity = (char)b;
+							if (msg.type == TML_NOTE_ON && b == 0) {
+								msg.type = TML_NOTE_OFF;
+							}
+							break;
+						case TML_KEY_PRESSURE:
+							msg.key = (char)a;
+							msg.key_pressure = (char)b;
+							break;
+						case TML_CONTROL_CHANGE:
+							msg.control = (char)a;
+							msg.control_value = (char)b;
+							break;
+						case TML_PROGRAM_CHANGE:
+							msg.program = (char)a;
+							break;
+						case TML_CHANNEL_PRESSURE:
+							msg.channel_pressure = (char)a;
+							break;
+						case TML_PITCH_BEND:
+							msg.pitch_bend = (unsigned short)(a | (b << 7));
+							break;
+					}
+					emit = true;
+				}
+			} else if (status == 0xF0 || status == 0xF7) {
+				track.running_status = 0;
+				uint32_t length = 0;
+				if (!read_vlq(track.pos, end, length) || (size_t)(end - track.pos) < length) {
+					track_done = true;
+				} else {
+					track.pos += length;
+				}
+			} else if (status == 0xFF) {
+				uint32_t length = 0;
+				if (track.pos >= end) {
+					track_done = true;
+				} else {
+					const uint8_t meta = *track.pos++;
+					if (!read_vlq(track.pos, end, length) || (size_t)(end - track.pos) < length) {
+						track_done = true;
+					} else if (meta == 0x2F) {
+						track_done = true;
+					} else {
+						if (meta == TML_SET_TEMPO && length == 3) {
+							const uint32_t usec_per_beat = read_be(track.pos, 3);
+							// Same byte layout tml_get_tempo_value() reads.
+							msg.type = TML_SET_TEMPO;
+							unsigned char *tempo = (unsigned char *)&msg.channel;
+							tempo[0] = track.pos[0];
+							tempo[1] = track.pos[1];
+							tempo[2] = track.pos[2];
+							emit = true;
+							if (usec_per_beat > 0 && ticks_per_second <= 0.0) {
+								tempo_ms = time_ms;
+								tempo_tick = tick;
+								ms_per_tick = (double)usec_per_beat / (1000.0 * division);
+							}
+							if (tempo_log_count == k_tempo_log_capacity) {
+								tempo_log_head = (tempo_log_head + 1) % k_tempo_log_capacity;
+								tempo_log_count--;
+							}
+							TempoChange &change = tempo_log[(tempo_log_head + tempo_log_count) % k_tempo_log_capacity];
+							change.time_ms = msg.time;
+							change.usec_per_beat = (int)usec_per_beat;
+							tempo_log_count++;
+						}
+						track.pos += length;
+					}
+				}
+			} else {
+				// Data byte with no running status: the track is corrupt from here on.
+				track_done = true;
+			}
+		}
+
+		if (track_done || !_read_delta(track)) {
+			_heap_remove_top();
+		} else {
+			_heap_sift_down(0);
+		}
+		if (emit) {
+			_push_message(msg);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool MidiSmfStream::_heap_less(int p_a, int p_b) const {
+	const uint64_t a = tracks[p_a].next_tick;
+	const uint64_t b = tracks[p_b].next_tick;
+	// Equal ticks go in track order so tempo on the conductor track lands first.
+	return a < b || (a == b && p_a < p_b);
+}
+
+void MidiSmfStream::_heap_sift_up(int p_index) {
+	while (p_index > 0) {
+		const int parent = (p_index - 1) / 2;
+		if (!_heap_less(heap[p_index], heap[parent])) {
+			break;
+		}
+		const int tmp = heap[p_index];
+		heap[p_index] = heap[parent];
+		heap[parent] = tmp;
+		p_index = parent;
+	}
+}
+
+void MidiSmfStream::_heap_sift_down(int p_index) {
+	for (;;) {
+		const int left = p_index * 2 + 1;
+		const int right = left + 1;
+		int smallest = p_index;
+		if (left < heap_size && _heap_less(heap[left], heap[smallest])) {
+			smallest = left;
+		}
+		if (right < heap_size && _heap_less(heap[right], heap[smallest])) {
+			smallest = right;
+		}
+		if (smallest == p_index) {
+			return;
+		}
+		const int tmp = heap[p_index];
+		heap[p_index] = heap[smallest];
+		heap[smallest] = tmp;
+		p_index = smallest;
+	}
+}
+
+void MidiSmfStream::_heap_remove_top() {
+	heap[0] = heap[--heap_size];
+	_heap_sift_down(0);
+}
+
+} // namespace godot
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../lib/TinySoundFont/tml.h"
+
+namespace godot {
+
+// Incremental Standard MIDI File reader. Tracks are merged by tick as the
+// playback cursor advances and decoded into a fixed ring of tml_message, so
+// memory does not depend on the length of the file and opening it costs only
+// the header and track table. Messages use TinyMidiLoader's layout (tempo in
+// channel/key/velocity, note-on with velocity 0 as note-off) so they go through
+// MidiEventDispatcher unchanged; their next pointers are always null.
+//
+// The stream reads from caller-owned bytes that must outlive it.
+class MidiSmfStream {
+public:
+	static constexpr int k_ring_capacity = 4096;
+	// Room for a full ring of tempo events, so one prefetch() never overruns it.
+	static constexpr int k_tempo_log_capacity = k_ring_capacity;
+
+	// Parses the header, locates the tracks and allocates the ring. Returns false
+	// if the data is not an SMF.
+	bool open(const uint8_t *p_data, size_t p_size);
+	void close();
+	bool is_open() const { return data != nullptr; }
+
+	// Back to the first event; O(tracks).
+	void rewind();
+
+	// Decodes ahead until the ring or the tempo log is full, or the file ends. Allocation-free.
+	void prefetch();
+	// Next message at or before p_time_ms, or nullptr. Decodes on demand if the ring ran dry.
+	const tml_message *peek(uint32_t p_time_ms);
+	void pop();
+	// Every track has ended and every decoded message was popped.
+	bool is_finished() const { return heap_size == 0 && ring_count == 0; }
+	// Time of the last message decoded so far; the song length once every track has ended.
+	uint32_t get_decoded_ms() const { return decoded_ms; }
+	bool is_fully_decoded() const { return heap_size == 0; }
+
+	// Tempo changes in decode order, for callers that keep a beat grid. prefetch()
+	// waits for the log to be drained; only on-demand decoding in peek() can
+	// overrun it, dropping the oldest entries.
+	bool pop_tempo_change(uint32_t &r_time_ms, int &r_usec_per_beat);
+
+private:
+	struct Track {
+		const uint8_t *begin = nullptr;
+		const uint8_t *end = nullptr;
+		const uint8_t *pos = nullptr;
+		uint64_t next_tick = 0;
+		uint8_t running_status = 0;
+	};
+
+	bool _read_delta(Track &r_track);
+	bool _decode_one();
+	void _push_message(const tml_message &p_msg);
+	bool _heap_less(int p_a, int p_b) const;
+	void _heap_sift_down(int p_index);
+	void _heap_sift_up(int p_index);
+	void _heap_remove_top();
+
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+	std::vector<Track> tracks; // sized once by open()
+	std::vector<int> heap; // track indices, earliest next_tick first
+	int heap_size = 0;
+
+	// Tick to millisecond conversion, advanced as tempo events are decoded.
+	int division = 480; // ticks per beat; SMPTE files use ticks_per_second instead
+	double ticks_per_second = 0.0;
+	double tempo_ms = 0.0;
+	uint64_t tempo_tick = 0;
+	double ms_per_tick = 0.0;
+	uint32_t decoded_ms = 0;
+
+	std::vector<tml_message> ring; // k_ring_capacity entries while open
+	int ring_head = 0;
+	int ring_count = 0;
+
+	struct TempoChange {
+		uint32_t time_ms = 0;
+		int usec_per_beat = 0;
+	};
+	std::vector<TempoChange> tempo_log; // k_tempo_log_capacity entries while open
+	int tempo_log_head = 0;
+	int tempo_log_count = 0;
+};
+
+} // namespace godot
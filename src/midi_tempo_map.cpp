@@ -0,0 +1,72 @@
+#include "midi_tempo_map.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../lib/TinySoundFont/tml.h"
+
+namespace godot {
+
+void MidiTempoMap::build(const tml_message *p_first) {
+	segments.clear();
+	segments.push_back(Segment());
+	for (const tml_message *msg = p_first; msg; msg = msg->next) {
+		if (msg->type == TML_SET_TEMPO) {
+			add_tempo((double)msg->time, tml_get_tempo_value(const_cast<tml_message *>(msg)));
+		}
+	}
+}
+
+void MidiTempoMap::add_tempo(double p_ms, int p_usec_per_beat) {
+	if (p_usec_per_beat <= 0) {
+		return;
+	}
+	if (segments.empty()) {
+		segments.push_back(Segment());
+	}
+	Segment &last = segments.back();
+	if (p_ms <= last.start_ms) {
+		last.ms_per_beat = p_usec_per_beat / 1000.0;
+		return;
+	}
+	Segment next;
+	next.start_ms = p_ms;
+	next.start_beat = last.start_beat + (next.start_ms - last.start_ms) / last.ms_per_beat;
+	next.ms_per_beat = p_usec_per_beat / 1000.0;
+	segments.push_back(next);
+}
+
+void MidiTempoMap::clear() {
+	segments.clear();
+}
+
+double MidiTempoMap::get_beat_at_ms(double p_ms) const {
+	if (segments.empty()) {
+		return p_ms / Segment().ms_per_beat;
+	}
+	auto it = std::upper_bound(segments.begin(), segments.end(), p_ms, [](double p_value, const Segment &p_segment) {
+		return p_value < p_segment.start_ms;
+	});
+	const Segment &segment = it == segments.begin() ? segments.front() : *(it - 1);
+	return segment.start_beat + (p_ms - segment.start_ms) / segment.ms_per_beat;
+}
+
+double MidiTempoMap::get_ms_at_beat(double p_beat) const {
+	if (segments.empty()) {
+		return p_beat * Segment().ms_per_beat;
+	}
+	auto it = std::upper_bound(segments.begin(), segments.end(), p_beat, [](double p_value, const Segment &p_segment) {
+		return p_value < p_segment.start_beat;
+	});
+	const Segment &segment = it == segments.begin() ? segments.front() : *(it - 1);
+	return segment.start_ms + (p_beat - segment.start_beat) * segment.ms_per_beat;
+}
+
+double MidiTempoMap::get_next_boundary_ms(double p_ms, int p_beats) const {
+	const double beats = (double)std::max(1, p_beats);
+	// The epsilon keeps a position sitting exactly on a boundary from choosing that same boundary.
+	const double next = (std::floor(get_beat_at_ms(p_ms) / beats + 1e-9) + 1.0) * beats;
+	return get_ms_at_beat(next);
+}
+
+} // namespace godot
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+struct tml_message;
+
+namespace godot {
+
+// Beat grid of a loaded MIDI file, built from its tempo events. TinyMidiLoader
+// bakes tempo into message times and drops time signatures, so bars are a
+// caller-supplied number of beats.
+class MidiTempoMap {
+public:
+	void build(const tml_message *p_first);
+	void clear();
+	// Appends a tempo change; p_ms must not precede earlier changes. Used to grow
+	// the map while a streamed file is decoded.
+	void add_tempo(double p_ms, int p_usec_per_beat);
+
+	double get_beat_at_ms(double p_ms) const;
+	double get_ms_at_beat(double p_beat) const;
+	// Time of the first multiple of p_beats beats strictly after p_ms
+	// (p_beats = 1: next beat, p_beats = beats per bar: next bar line).
+	double get_next_boundary_ms(double p_ms, int p_beats) const;
+
+private:
+	struct Segment {
+		double start_ms = 0.0;
+		double start_beat = 0.0;
+		double ms_per_beat = 500.0; // 120 BPM until the first tempo event
+	};
+	std::vector<Segment> segments;
+};
+
+} // namespace godot
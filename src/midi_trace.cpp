@@ -0,0 +1,185 @@
+#include "midi_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+static constexpr int k_min_events_per_thread = 1024;
+static constexpr int k_max_events_per_thread = 1 << 22;
+
+namespace {
+
+struct TraceEvent {
+	const char *name = nullptr;
+	uint64_t start_usec = 0;
+	uint64_t dur_usec = 0;
+	int64_t voices = -1;
+	int64_t events = -1;
+	int64_t frame = -1;
+};
+
+// Written only by the thread that claimed it; written counts every event ever recorded.
+struct TraceRing {
+	std::unique_ptr<TraceEvent[]> events;
+	std::atomic<uint64_t> written{ 0 };
+	std::atomic<bool> is_main{ false };
+};
+
+TraceRing rings[MidiTrace::k_max_threads];
+uint64_t ring_capacity = 0; // power of two
+std::atomic<bool> enabled{ false };
+std::atomic<int> rings_claimed{ 0 };
+// Bumped by start(), so threads claim a fresh ring per recording.
+std::atomic<uint32_t> generation{ 0 };
+// Recorders inside record(); start() and shutdown() wait for it before touching the rings.
+std::atomic<int> in_flight{ 0 };
+std::atomic<std::thread::id> main_thread;
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+thread_local int tls_ring = -1;
+thread_local uint32_t tls_generation = 0;
+
+void quiesce() {
+	enabled.store(false);
+	while (in_flight.load() > 0) {
+		std::this_thread::yield();
+	}
+}
+
+void append_int(std::string &r_out, const char *p_key, int64_t p_value, bool &r_first) {
+	if (p_value < 0) {
+		return;
+	}
+	r_out += r_first ? "\"" : ",\"";
+	r_out += p_key;
+	r_out += "\":";
+	r_out += std::to_string(p_value);
+	r_first = false;
+}
+
+} // namespace
+
+void MidiTrace::start(int p_events_per_thread) {
+	quiesce();
+	const uint64_t wanted = (uint64_t)std::max(k_min_events_per_thread, std::min(k_max_events_per_thread, p_events_per_thread));
+	uint64_t capacity = 1;
+	while (capacity < wanted) {
+		capacity <<= 1;
+	}
+	if (capacity != ring_capacity) {
+		for (TraceRing &ring : rings) {
+			ring.events.reset(new TraceEvent[capacity]);
+		}
+		ring_capacity = capacity;
+	}
+	for (TraceRing &ring : rings) {
+		ring.written.store(0);
+	}
+	rings_claimed.store(0);
+	main_thread.store(std::this_thread::get_id());
+	generation.fetch_add(1);
+	enabled.store(true);
+}
+
+void MidiTrace::stop() {
+	enabled.store(false, std::memory_order_relaxed);
+}
+
+bool MidiTrace::is_enabled() {
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void MidiTrace::shutdown() {
+	quiesce();
+	for (TraceRing &ring : rings) {
+		ring.events.reset();
+		ring.written.store(0);
+	}
+	ring_capacity = 0;
+}
+
+uint64_t MidiTrace::now_usec() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void MidiTrace::record(const char *p_name, uint64_t p_start_usec, uint64_t p_end_usec, int64_t p_voices, int64_t p_events, int64_t p_frame) {
+	in_flight.fetch_add(1);
+	if (!enabled.load()) {
+		in_flight.fetch_sub(1);
+		return;
+	}
+	const uint32_t current = generation.load();
+	if (tls_generation != current) {
+		tls_generation = current;
+		tls_ring = rings_claimed.fetch_add(1);
+		if (tls_ring < k_max_threads) {
+			rings[tls_ring].is_main.store(std::this_thread::get_id() == main_thread.load(), std::memory_order_relaxed);
+		}
+	}
+	if (tls_ring >= k_max_threads) {
+		in_flight.fetch_sub(1);
+		return;
+	}
+
+	TraceRing &ring = rings[tls_ring];
+	const uint64_t index = ring.written.load(std::memory_order_relaxed);
+	TraceEvent &event = ring.events[index & (ring_capacity - 1)];
+	event.name = p_name;
+	event.start_usec = p_start_usec;
+	event.dur_usec = p_end_usec - p_start_usec;
+	event.voices = p_voices;
+	event.events = p_events;
+	event.frame = p_frame;
+	ring.written.store(index + 1, std::memory_order_release);
+	in_flight.fetch_sub(1);
+}
+
+std::string MidiTrace::dump_json() {
+	std::string out = "{\"traceEvents\":[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"MidiPlayer\"}}";
+	const int claimed = std::min(rings_claimed.load(), k_max_threads);
+	std::vector<TraceEvent> copy;
+	for (int r = 0; r < claimed; r++) {
+		TraceRing &ring = rings[r];
+		const uint64_t end = ring.written.load(std::memory_order_acquire);
+		if (end == 0 || !ring.events) {
+			continue;
+		}
+		const uint64_t begin = end > ring_capacity ? end - ring_capacity : 0;
+		copy.resize((size_t)(end - begin));
+		for (uint64_t i = begin; i < end; i++) {
+			copy[(size_t)(i - begin)] = ring.events[i & (ring_capacity - 1)];
+		}
+		// Anything the writer lapped while we copied is unreliable, and so is the slot of
+		// event `after`, which it may be filling now (written is bumped only once it is done).
+		const uint64_t after = ring.written.load(std::memory_order_acquire);
+		const uint64_t valid_from = after + 1 > ring_capacity ? after + 1 - ring_capacity : 0;
+
+		const std::string tid = std::to_string(r + 1);
+		out += ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":\"";
+		out += ring.is_main.load(std::memory_order_relaxed) ? std::string("main") : "thread " + tid;
+		out += "\"}}";
+		for (uint64_t i = std::max(begin, valid_from); i < end; i++) {
+			const TraceEvent &event = copy[(size_t)(i - begin)];
+			out += ",{\"name\":\"";
+			out += event.name;
+			out += "\",\"cat\":\"midi\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid;
+			out += ",\"ts\":" + std::to_string(event.start_usec);
+			out += ",\"dur\":" + std::to_string(event.dur_usec);
+			out += ",\"args\":{";
+			bool first = true;
+			append_int(out, "voices", event.voices, first);
+			append_int(out, "events", event.events, first);
+			append_int(out, "frame", event.frame, first);
+			out += "}}";
+		}
+	}
+	out += "],\"displayTimeUnit\":\"ms\"}";
+	return out;
+}
+
+} // namespace godot
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace godot {
+
+// Opt-in timeline tracer (MidiPlayer.start_trace()). Scopes record their start
+// time, duration and optional voice/event counts into a ring owned by the
+// recording thread; dump_json() serializes them in the Chrome trace event
+// format, which chrome://tracing and ui.perfetto.dev open directly.
+//
+// Recording is lock-free and allocation-free, so scopes may sit inside
+// MIDI_RT_SCOPE. While tracing is off a scope costs one relaxed atomic load.
+// Each ring keeps the most recent events of its thread; older ones are overwritten.
+class MidiTrace {
+public:
+	static constexpr int k_max_threads = 16;
+
+	// Call from the main thread; it is named "main" in the trace.
+	static void start(int p_events_per_thread);
+	static void stop();
+	static bool is_enabled();
+	// Safe while recording: events overwritten during the copy are left out.
+	static std::string dump_json();
+	// Releases the rings. Called when the extension unloads.
+	static void shutdown();
+
+	static uint64_t now_usec();
+	static void record(const char *p_name, uint64_t p_start_usec, uint64_t p_end_usec, int64_t p_voices, int64_t p_events, int64_t p_frame);
+};
+
+class MidiTraceScope {
+public:
+	explicit MidiTraceScope(const char *p_name) :
+			name(p_name), active(MidiTrace::is_enabled()) {
+		if (active) {
+			start_usec = MidiTrace::now_usec();
+		}
+	}
+	~MidiTraceScope() {
+		if (active) {
+			MidiTrace::record(name, start_usec, MidiTrace::now_usec(), voices, events, frame);
+		}
+	}
+
+	MidiTraceScope(const MidiTraceScope &) = delete;
+	MidiTraceScope &operator=(const MidiTraceScope &) = delete;
+
+	// Whether this scope records. Guard argument computations with it so they
+	// cost nothing while tracing is off.
+	bool is_active() const { return active; }
+
+	// Optional arguments shown with the slice; negative values are omitted.
+	int64_t voices = -1;
+	int64_t events = -1;
+	int64_t frame = -1;
+
+private:
+	const char *name;
+	bool active;
+	uint64_t start_usec = 0;
+};
+
+} // namespace godot
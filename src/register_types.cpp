@@ -5,8 +5,12 @@
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/classes/editor_plugin_registration.hpp>
 
+#include "midi_effect_buses.h"
+#include "midi_performance.h"
 #include "midi_player.h"
+#include "midi_player_spatial.h"
 #include "midi_resources.h"
+#include "midi_trace.h"
 #include "midi_importers.h"
 #include "midi_editor_plugin.h"
 
@@ -16,7 +20,10 @@ void initialize_midi_player_module(ModuleInitializationLevel p_level) {
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
 		ClassDB::register_class<MidiFileResource>();
 		ClassDB::register_class<SoundFontResource>();
+		ClassDB::register_class<MidiSequence>();
 		ClassDB::register_class<MidiPlayer>();
+		ClassDB::register_class<MidiPlayer3D>();
+		ClassDB::register_class<MidiPlayer2D>();
 	}
 	if (p_level == MODULE_INITIALIZATION_LEVEL_EDITOR) {
 		ClassDB::register_class<MidiImporter>();
@@ -27,6 +34,11 @@ void initialize_midi_player_module(ModuleInitializationLevel p_level) {
 }
 
 void uninitialize_midi_player_module(ModuleInitializationLevel p_level) {
+	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
+		MidiPerformanceMonitors::remove_monitors();
+		MidiEffectBuses::shutdown();
+		MidiTrace::shutdown();
+	}
 	if (p_level == MODULE_INITIALIZATION_LEVEL_EDITOR) {
 		EditorPlugins::remove_by_type<MidiEditorPlugin>();
 	}
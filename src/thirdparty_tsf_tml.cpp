@@ -7,5 +7,540 @@
 #define TML_IMPLEMENTATION
 #define TML_NO_STDIO
 
+#ifdef MIDI_RT_AUDIT
+// Route the libraries' heap use through the audit hooks (see midi_rt_audit.h).
+#include "midi_rt_audit.h"
+#define TSF_MALLOC midi_rt_audit_malloc
+#define TSF_REALLOC midi_rt_audit_realloc
+#define TSF_FREE midi_rt_audit_free
+#define TML_MALLOC midi_rt_audit_malloc
+#define TML_REALLOC midi_rt_audit_realloc
+#define TML_FREE midi_rt_audit_free
+#endif
+
+#ifndef MIDI_EXACT_MATH
+// Pitch ratio, envelope and dB-to-gain math with bounded-error approximations
+// (see midi_fast_math.h). tsf.h falls back to libm only if one of these is missing.
+#include "midi_fast_math.h"
+#define TSF_POW godot::midi_fast_pow
+#define TSF_POWF godot::midi_fast_powf
+#define TSF_EXPF godot::midi_fast_expf
+#define TSF_LOG10 godot::midi_fast_log10f
+#define TSF_LOG std::log
+#define TSF_TAN std::tan
+#define TSF_SQRT std::sqrt
+#define TSF_SQRTF std::sqrt
+#endif
+
 #include "../lib/TinySoundFont/tsf.h"
 #include "../lib/TinySoundFont/tml.h"
+
+#include "tsf_ext.h"
+
+#include <climits>
+#include <cstring>
+
+static int tsfx_voice_priority(const struct tsf_voice *p_voice, const int *p_channel_priority) {
+	if (p_voice->playingChannel < 0 || p_voice->playingChannel >= 16 || !p_channel_priority) {
+		return INT_MAX;
+	}
+	return p_channel_priority[p_voice->playingChannel];
+}
+
+int tsfx_voice_count(const tsf *p_synth, int p_channel) {
+	int count = 0;
+	const struct tsf_voice *v = p_synth->voices, *v_end = v + p_synth->voiceNum;
+	for (; v != v_end; v++) {
+		if (v->playingPreset != -1 && (p_channel < 0 || v->playingChannel == p_channel)) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int tsfx_note_voice_count(const tsf *p_synth, int p_preset_index, int p_key, float p_vel) {
+	if (p_preset_index < 0 || p_preset_index >= p_synth->presetNum || p_vel <= 0.0f) {
+		return 0;
+	}
+	// Same matching as tsf_note_on().
+	const int midi_velocity = (int)(p_vel * 127);
+	int count = 0;
+	const struct tsf_region *region = p_synth->presets[p_preset_index].regions;
+	const struct tsf_region *region_end = region + p_synth->presets[p_preset_index].regionNum;
+	for (; region != region_end; region++) {
+		if (p_key >= region->lokey && p_key <= region->hikey && midi_velocity >= region->lovel && midi_velocity <= region->hivel) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int tsfx_channel_preset_index(const tsf *p_synth, int p_channel) {
+	if (!p_synth->channels || p_channel < 0 || p_channel >= p_synth->channels->channelNum) {
+		return -1;
+	}
+	return p_synth->channels->channels[p_channel].presetIndex;
+}
+
+int tsfx_pick_steal_voice(const tsf *p_synth, int p_policy, int p_channel, const int *p_channel_priority, int p_incoming_priority) {
+	int best = -1;
+	float best_score = 0.0f;
+	unsigned int best_play_index = 0;
+
+	for (int i = 0; i < p_synth->voiceNum; i++) {
+		const struct tsf_voice *v = &p_synth->voices[i];
+		if (v->playingPreset == -1 || (p_channel >= 0 && v->playingChannel != p_channel)) {
+			continue;
+		}
+
+		// Lower score is stolen first; ties go to the oldest voice.
+		float score = 0.0f;
+		switch (p_policy) {
+			case TSFX_STEAL_QUIETEST:
+				score = v->ampenv.level * tsf_decibelsToGain(v->noteGainDB);
+				break;
+			case TSFX_STEAL_LOWEST_PRIORITY: {
+				const int priority = tsfx_voice_priority(v, p_channel_priority);
+				if (priority > p_incoming_priority) {
+					continue;
+				}
+				score = (float)priority;
+			} break;
+			case TSFX_STEAL_RELEASED_FIRST:
+				score = (v->ampenv.segment == TSF_SEGMENT_RELEASE ? 0.0f : 1.0f);
+				break;
+			case TSFX_STEAL_OLDEST:
+			default:
+				break;
+		}
+
+		if (best < 0 || score < best_score || (score == best_score && v->playIndex < best_play_index)) {
+			best = i;
+			best_score = score;
+			best_play_index = v->playIndex;
+		}
+	}
+	return best;
+}
+
+void tsfx_voice_kill(tsf *p_synth, int p_voice) {
+	if (p_voice >= 0 && p_voice < p_synth->voiceNum) {
+		tsf_voice_kill(&p_synth->voices[p_voice]);
+	}
+}
+
+void tsfx_drop_release_filters(tsf *p_synth) {
+	struct tsf_voice *v = p_synth->voices, *v_end = v + p_synth->voiceNum;
+	for (; v != v_end; v++) {
+		// A modulated cutoff is part of how the release sounds (filter sweeps), so it stays.
+		if (v->playingPreset != -1 && v->ampenv.segment == TSF_SEGMENT_RELEASE &&
+				!v->region->modLfoToFilterFc && !v->region->modEnvToFilterFc) {
+			v->lowpass.active = 0;
+		}
+	}
+}
+
+void tsfx_kill_quiet_released_voices(tsf *p_synth, float p_max_gain) {
+	struct tsf_voice *v = p_synth->voices, *v_end = v + p_synth->voiceNum;
+	for (; v != v_end; v++) {
+		if (v->playingPreset != -1 && v->ampenv.segment == TSF_SEGMENT_RELEASE &&
+				v->ampenv.level * tsf_decibelsToGain(v->noteGainDB) < p_max_gain) {
+			tsf_voice_kill(v);
+		}
+	}
+}
+
+// Interpolation kernels. p_pos is the integer sample position, p_alpha the fraction.
+template <int Interp>
+struct TsfxKernel;
+
+template <>
+struct TsfxKernel<TSFX_INTERP_NEAREST> {
+	static inline float sample(const float *p_input, unsigned int p_pos, float p_alpha, bool p_looping, unsigned int p_loop_start, unsigned int p_loop_end) {
+		(void)p_alpha;
+		(void)p_looping;
+		(void)p_loop_start;
+		(void)p_loop_end;
+		return p_input[p_pos];
+	}
+};
+
+template <>
+struct TsfxKernel<TSFX_INTERP_LINEAR> {
+	static inline float sample(const float *p_input, unsigned int p_pos, float p_alpha, bool p_looping, unsigned int p_loop_start, unsigned int p_loop_end) {
+		// Same as TSF's own renderer; needed where TSF's renderer can't be used (routed output).
+		const unsigned int next = (p_pos >= p_loop_end && p_looping) ? p_loop_start : p_pos + 1;
+		return p_input[p_pos] * (1.0f - p_alpha) + p_input[next] * p_alpha;
+	}
+};
+
+template <>
+struct TsfxKernel<TSFX_INTERP_CUBIC> {
+	static inline float sample(const float *p_input, unsigned int p_pos, float p_alpha, bool p_looping, unsigned int p_loop_start, unsigned int p_loop_end) {
+		// 4-point Catmull-Rom. SoundFont samples are followed by at least 46 zero
+		// samples, so reading two past a non-looping end stays inside the buffer.
+		const unsigned int prev = (p_looping && p_pos == p_loop_start) ? p_loop_end : (p_pos ? p_pos - 1 : 0);
+		const unsigned int next = (p_looping && p_pos >= p_loop_end) ? p_loop_start : p_pos + 1;
+		const unsigned int next2 = (p_looping && next >= p_loop_end) ? p_loop_start : next + 1;
+		const float y0 = p_input[prev], y1 = p_input[p_pos], y2 = p_input[next], y3 = p_input[next2];
+		const float c1 = 0.5f * (y2 - y0);
+		const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+		const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+		return ((c3 * p_alpha + c2) * p_alpha + c1) * p_alpha + y1;
+	}
+};
+
+// Mirror of tsf_voice_render() for TSF_STEREO_INTERLEAVED output with the
+// interpolation step swapped for TsfxKernel<Interp>.
+template <int Interp>
+static void tsfx_voice_render(tsf *f, struct tsf_voice *v, float *p_output, int p_samples) {
+	struct tsf_region *region = v->region;
+	const float *input = f->fontSamples;
+	float *out = p_output;
+
+	TSF_BOOL updateModEnv = (region->modEnvToPitch || region->modEnvToFilterFc);
+	TSF_BOOL updateModLFO = (v->modlfo.delta && (region->modLfoToPitch || region->modLfoToFilterFc || region->modLfoToVolume));
+	TSF_BOOL updateVibLFO = (v->viblfo.delta && (region->vibLfoToPitch));
+	const bool isLooping = (v->loopStart < v->loopEnd);
+	unsigned int tmpLoopStart = v->loopStart, tmpLoopEnd = v->loopEnd;
+	double tmpSampleEndDbl = (double)region->end, tmpLoopEndDbl = (double)tmpLoopEnd + 1.0;
+	double tmpSourceSamplePosition = v->sourceSamplePosition;
+	struct tsf_voice_lowpass tmpLowpass = v->lowpass;
+
+	TSF_BOOL dynamicLowpass = (region->modLfoToFilterFc || region->modEnvToFilterFc);
+	float tmpSampleRate = f->outSampleRate, tmpInitialFilterFc, tmpModLfoToFilterFc, tmpModEnvToFilterFc;
+
+	TSF_BOOL dynamicPitchRatio = (region->modLfoToPitch || region->modEnvToPitch || region->vibLfoToPitch);
+	double pitchRatio;
+	float tmpModLfoToPitch, tmpVibLfoToPitch, tmpModEnvToPitch;
+
+	TSF_BOOL dynamicGain = (region->modLfoToVolume != 0);
+	float noteGain = 0, tmpModLfoToVolume;
+
+	if (dynamicLowpass) {
+		tmpInitialFilterFc = (float)region->initialFilterFc, tmpModLfoToFilterFc = (float)region->modLfoToFilterFc, tmpModEnvToFilterFc = (float)region->modEnvToFilterFc;
+	} else {
+		tmpInitialFilterFc = 0, tmpModLfoToFilterFc = 0, tmpModEnvToFilterFc = 0;
+	}
+
+	if (dynamicPitchRatio) {
+		pitchRatio = 0, tmpModLfoToPitch = (float)region->modLfoToPitch, tmpVibLfoToPitch = (float)region->vibLfoToPitch, tmpModEnvToPitch = (float)region->modEnvToPitch;
+	} else {
+		pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents) * v->pitchOutputFactor, tmpModLfoToPitch = 0, tmpVibLfoToPitch = 0, tmpModEnvToPitch = 0;
+	}
+
+	if (dynamicGain) {
+		tmpModLfoToVolume = (float)region->modLfoToVolume * 0.1f;
+	} else {
+		noteGain = tsf_decibelsToGain(v->noteGainDB), tmpModLfoToVolume = 0;
+	}
+
+	while (p_samples) {
+		float gainMono, gainLeft, gainRight;
+		int blockSamples = (p_samples > TSF_RENDER_EFFECTSAMPLEBLOCK ? TSF_RENDER_EFFECTSAMPLEBLOCK : p_samples);
+		p_samples -= blockSamples;
+
+		if (dynamicLowpass) {
+			float fres = tmpInitialFilterFc + v->modlfo.level * tmpModLfoToFilterFc + v->modenv.level * tmpModEnvToFilterFc;
+			float lowpassFc = (fres <= 13500 ? tsf_cents2Hertz(fres) / tmpSampleRate : 1.0f);
+			tmpLowpass.active = (lowpassFc < 0.499f);
+			if (tmpLowpass.active) {
+				tsf_voice_lowpass_setup(&tmpLowpass, lowpassFc);
+			}
+		}
+
+		if (dynamicPitchRatio) {
+			pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents + (v->modlfo.level * tmpModLfoToPitch + v->viblfo.level * tmpVibLfoToPitch + v->modenv.level * tmpModEnvToPitch)) * v->pitchOutputFactor;
+		}
+
+		if (dynamicGain) {
+			noteGain = tsf_decibelsToGain(v->noteGainDB + (v->modlfo.level * tmpModLfoToVolume));
+		}
+
+		gainMono = noteGain * v->ampenv.level;
+
+		tsf_voice_envelope_process(&v->ampenv, blockSamples, tmpSampleRate);
+		if (updateModEnv) {
+			tsf_voice_envelope_process(&v->modenv, blockSamples, tmpSampleRate);
+		}
+		if (updateModLFO) {
+			tsf_voice_lfo_process(&v->modlfo, blockSamples);
+		}
+		if (updateVibLFO) {
+			tsf_voice_lfo_process(&v->viblfo, blockSamples);
+		}
+
+		gainLeft = gainMono * v->panFactorLeft, gainRight = gainMono * v->panFactorRight;
+		while (blockSamples-- && tmpSourceSamplePosition < tmpSampleEndDbl) {
+			unsigned int pos = (unsigned int)tmpSourceSamplePosition;
+			float alpha = (float)(tmpSourceSamplePosition - pos);
+			float val = TsfxKernel<Interp>::sample(input, pos, alpha, isLooping, tmpLoopStart, tmpLoopEnd);
+
+			if (tmpLowpass.active) {
+				val = tsf_voice_lowpass_process(&tmpLowpass, val);
+			}
+
+			*out++ += val * gainLeft;
+			*out++ += val * gainRight;
+
+			tmpSourceSamplePosition += pitchRatio;
+			if (tmpSourceSamplePosition >= tmpLoopEndDbl && isLooping) {
+				tmpSourceSamplePosition -= (tmpLoopEnd - tmpLoopStart + 1.0);
+			}
+		}
+
+		if (tmpSourceSamplePosition >= tmpSampleEndDbl || v->ampenv.segment == TSF_SEGMENT_DONE) {
+			tsf_voice_kill(v);
+			return;
+		}
+	}
+
+	v->sourceSamplePosition = tmpSourceSamplePosition;
+	if (tmpLowpass.active || dynamicLowpass) {
+		v->lowpass = tmpLowpass;
+	}
+}
+
+template <int Interp>
+static void tsfx_render_voices(tsf *p_synth, float *p_buffer, int p_samples) {
+	struct tsf_voice *v = p_synth->voices, *v_end = v + p_synth->voiceNum;
+	for (; v != v_end; v++) {
+		if (v->playingPreset != -1) {
+			tsfx_voice_render<Interp>(p_synth, v, p_buffer, p_samples);
+		}
+	}
+}
+
+void tsfx_render_float(tsf *p_synth, float *p_buffer, int p_samples, int p_flag_mixing, int p_interpolation) {
+	if (p_interpolation == TSFX_INTERP_LINEAR || p_synth->outputmode != TSF_STEREO_INTERLEAVED) {
+		tsf_render_float(p_synth, p_buffer, p_samples, p_flag_mixing);
+		return;
+	}
+
+	if (!p_flag_mixing) {
+		TSF_MEMSET(p_buffer, 0, 2 * sizeof(float) * p_samples);
+	}
+	if (p_interpolation == TSFX_INTERP_NEAREST) {
+		tsfx_render_voices<TSFX_INTERP_NEAREST>(p_synth, p_buffer, p_samples);
+	} else {
+		tsfx_render_voices<TSFX_INTERP_CUBIC>(p_synth, p_buffer, p_samples);
+	}
+}
+
+template <int Interp>
+static void tsfx_render_voices_routed(tsf *p_synth, float *const *p_buffers, int p_buffer_count, const int *p_channel_buffer, int p_samples) {
+	struct tsf_voice *v = p_synth->voices, *v_end = v + p_synth->voiceNum;
+	for (; v != v_end; v++) {
+		if (v->playingPreset == -1) {
+			continue;
+		}
+		int target = 0;
+		if (v->playingChannel >= 0 && v->playingChannel < 16) {
+			target = p_channel_buffer[v->playingChannel];
+			if (target < 0 || target >= p_buffer_count) {
+				target = 0;
+			}
+		}
+		tsfx_voice_render<Interp>(p_synth, v, p_buffers[target], p_samples);
+	}
+}
+
+void tsfx_render_float_routed(tsf *p_synth, float *const *p_buffers, int p_buffer_count, const int *p_channel_buffer, int p_samples, int p_interpolation) {
+	for (int i = 0; i < p_buffer_count; i++) {
+		TSF_MEMSET(p_buffers[i], 0, 2 * sizeof(float) * p_samples);
+	}
+	if (p_synth->outputmode != TSF_STEREO_INTERLEAVED) {
+		tsf_render_float(p_synth, p_buffers[0], p_samples, 1);
+		return;
+	}
+	switch (p_interpolation) {
+		case TSFX_INTERP_NEAREST:
+			tsfx_render_voices_routed<TSFX_INTERP_NEAREST>(p_synth, p_buffers, p_buffer_count, p_channel_buffer, p_samples);
+			break;
+		case TSFX_INTERP_CUBIC:
+			tsfx_render_voices_routed<TSFX_INTERP_CUBIC>(p_synth, p_buffers, p_buffer_count, p_channel_buffer, p_samples);
+			break;
+		default:
+			tsfx_render_voices_routed<TSFX_INTERP_LINEAR>(p_synth, p_buffers, p_buffer_count, p_channel_buffer, p_samples);
+			break;
+	}
+}
+
+template <int Interp>
+static unsigned int tsfx_render_voices_channels(tsf *p_synth, float *const *p_buffers, int p_samples) {
+	unsigned int used = 0;
+	struct tsf_voice *v = p_synth->voices, *v_end = v + p_synth->voiceNum;
+	for (; v != v_end; v++) {
+		if (v->playingPreset == -1) {
+			continue;
+		}
+		const int index = (v->playingChannel >= 0 && v->playingChannel < 16) ? v->playingChannel : 16;
+		if (!(used & (1u << index))) {
+			TSF_MEMSET(p_buffers[index], 0, 2 * sizeof(float) * p_samples);
+			used |= 1u << index;
+		}
+		tsfx_voice_render<Interp>(p_synth, v, p_buffers[index], p_samples);
+	}
+	return used;
+}
+
+unsigned int tsfx_render_float_channels(tsf *p_synth, float *const *p_buffers, int p_samples, int p_interpolation) {
+	if (p_synth->outputmode != TSF_STEREO_INTERLEAVED) {
+		tsf_render_float(p_synth, p_buffers[16], p_samples, 0);
+		return 1u << 16;
+	}
+	switch (p_interpolation) {
+		case TSFX_INTERP_NEAREST:
+			return tsfx_render_voices_channels<TSFX_INTERP_NEAREST>(p_synth, p_buffers, p_samples);
+		case TSFX_INTERP_CUBIC:
+			return tsfx_render_voices_channels<TSFX_INTERP_CUBIC>(p_synth, p_buffers, p_samples);
+		default:
+			return tsfx_render_voices_channels<TSFX_INTERP_LINEAR>(p_synth, p_buffers, p_samples);
+	}
+}
+
+void tsfx_kill_all_voices(tsf *p_synth) {
+	struct tsf_voice *v = p_synth->voices, *v_end = v + p_synth->voiceNum;
+	for (; v != v_end; v++) {
+		if (v->playingPreset != -1) {
+			tsf_voice_kill(v);
+		}
+	}
+}
+
+struct tsfx_state_header {
+	unsigned int magic;
+	int preset_count;
+	int voice_count;
+	int channel_count;
+	int active_channel;
+	unsigned int voice_play_index;
+};
+
+struct tsfx_state_voice {
+	int slot;
+	int region_index;
+	struct tsf_voice voice; // region pointer cleared
+};
+
+static const unsigned int k_tsfx_state_magic = 0x54535831; // "TSX1"
+
+int tsfx_state_size(const tsf *p_synth) {
+	const int channels = p_synth->channels ? p_synth->channels->channelNum : 0;
+	return (int)(sizeof(struct tsfx_state_header) + (size_t)tsfx_voice_count(p_synth, -1) * sizeof(struct tsfx_state_voice) + (size_t)channels * sizeof(struct tsf_channel));
+}
+
+int tsfx_state_save(const tsf *p_synth, unsigned char *p_buffer, int p_capacity) {
+	const int size = tsfx_state_size(p_synth);
+	if (!p_buffer || p_capacity < size) {
+		return -1;
+	}
+	struct tsfx_state_header header;
+	header.magic = k_tsfx_state_magic;
+	header.preset_count = p_synth->presetNum;
+	header.voice_count = tsfx_voice_count(p_synth, -1);
+	header.channel_count = p_synth->channels ? p_synth->channels->channelNum : 0;
+	header.active_channel = p_synth->channels ? p_synth->channels->activeChannel : 0;
+	header.voice_play_index = p_synth->voicePlayIndex;
+	memcpy(p_buffer, &header, sizeof(header));
+	unsigned char *out = p_buffer + sizeof(header);
+
+	for (int i = 0; i < p_synth->voiceNum; i++) {
+		const struct tsf_voice *v = &p_synth->voices[i];
+		if (v->playingPreset == -1) {
+			continue;
+		}
+		struct tsfx_state_voice saved;
+		saved.slot = i;
+		saved.region_index = (int)(v->region - p_synth->presets[v->playingPreset].regions);
+		saved.voice = *v;
+		saved.voice.region = TSF_NULL;
+		memcpy(out, &saved, sizeof(saved));
+		out += sizeof(saved);
+	}
+	if (header.channel_count > 0) {
+		memcpy(out, p_synth->channels->channels, (size_t)header.channel_count * sizeof(struct tsf_channel));
+	}
+	return size;
+}
+
+int tsfx_state_check(const tsf *p_synth, const unsigned char *p_buffer, int p_size) {
+	struct tsfx_state_header header;
+	if (!p_buffer || p_size < (int)sizeof(header)) {
+		return 0;
+	}
+	memcpy(&header, p_buffer, sizeof(header));
+	return header.magic == k_tsfx_state_magic && header.preset_count == p_synth->presetNum && header.voice_count >= 0 && header.channel_count >= 0 && header.channel_count <= 16 &&
+			p_size == (int)(sizeof(header) + (size_t)header.voice_count * sizeof(struct tsfx_state_voice) + (size_t)header.channel_count * sizeof(struct tsf_channel));
+}
+
+int tsfx_state_load(tsf *p_synth, const unsigned char *p_buffer, int p_size) {
+	if (!tsfx_state_check(p_synth, p_buffer, p_size)) {
+		return 0;
+	}
+	struct tsfx_state_header header;
+	memcpy(&header, p_buffer, sizeof(header));
+	const unsigned char *in = p_buffer + sizeof(header);
+
+	tsfx_kill_all_voices(p_synth);
+	for (int i = 0; i < header.voice_count; i++, in += sizeof(struct tsfx_state_voice)) {
+		struct tsfx_state_voice saved;
+		memcpy(&saved, in, sizeof(saved));
+		const int preset = saved.voice.playingPreset;
+		if (saved.slot < 0 || preset < 0 || preset >= p_synth->presetNum || saved.region_index < 0 || saved.region_index >= p_synth->presets[preset].regionNum) {
+			continue;
+		}
+		if (saved.slot >= p_synth->voiceNum) {
+			// Same growth as tsf_note_on(); a synth with a fixed voice count drops the voice instead.
+			if (p_synth->maxVoiceNum) {
+				continue;
+			}
+			const int old_count = p_synth->voiceNum;
+			struct tsf_voice *voices = (struct tsf_voice *)TSF_REALLOC(p_synth->voices, (saved.slot + 1) * sizeof(struct tsf_voice));
+			if (!voices) {
+				continue;
+			}
+			p_synth->voices = voices;
+			p_synth->voiceNum = saved.slot + 1;
+			for (int v = old_count; v < p_synth->voiceNum; v++) {
+				p_synth->voices[v].playingPreset = -1;
+			}
+		}
+		struct tsf_voice *v = &p_synth->voices[saved.slot];
+		*v = saved.voice;
+		v->region = &p_synth->presets[preset].regions[saved.region_index];
+	}
+	p_synth->voicePlayIndex = header.voice_play_index;
+
+	if (p_synth->channels && p_synth->channels->channelNum > header.channel_count) {
+		// Channels the state never used go back to their defaults.
+		TSF_FREE(p_synth->channels);
+		p_synth->channels = TSF_NULL;
+	}
+	if (header.channel_count > 0) {
+		if (!tsf_channel_init(p_synth, header.channel_count - 1)) {
+			return 0;
+		}
+		memcpy(p_synth->channels->channels, in, (size_t)header.channel_count * sizeof(struct tsf_channel));
+		p_synth->channels->activeChannel = header.active_channel;
+	}
+	return 1;
+}
+
+long long tsfx_font_memory_bytes(const tsf *p_synth) {
+	// TSF doesn't keep the sample count; the furthest region end bounds it.
+	unsigned int sample_end = 0;
+	long long bytes = 0;
+	for (int p = 0; p < p_synth->presetNum; p++) {
+		const struct tsf_preset *preset = &p_synth->presets[p];
+		bytes += (long long)preset->regionNum * (long long)sizeof(struct tsf_region);
+		for (int r = 0; r < preset->regionNum; r++) {
+			const struct tsf_region *region = &preset->regions[r];
+			const unsigned int end = (region->end > region->loop_end ? region->end : region->loop_end) + 1;
+			if (end > sample_end) {
+				sample_end = end;
+			}
+		}
+	}
+	return bytes + (long long)p_synth->presetNum * (long long)sizeof(struct tsf_preset) + (long long)sample_end * (long long)sizeof(float);
+}
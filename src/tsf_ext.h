@@ -0,0 +1,83 @@
+#pragma once
+
+// Small extensions to TinySoundFont that need access to its internal voice
+// list. They are implemented in thirdparty_tsf_tml.cpp, the only translation
+// unit that sees the TSF implementation.
+
+struct tsf;
+
+enum TsfxStealPolicy {
+	TSFX_STEAL_OLDEST = 0,
+	TSFX_STEAL_QUIETEST,
+	TSFX_STEAL_LOWEST_PRIORITY,
+	TSFX_STEAL_RELEASED_FIRST,
+};
+
+// Number of playing voices (including releasing ones) on a channel, or on all
+// channels when p_channel is negative.
+int tsfx_voice_count(const tsf *p_synth, int p_channel);
+
+// Number of voices a note-on would start: the regions of the preset that match
+// p_key and p_vel. p_channel_preset_index() gives the preset a channel plays, or
+// -1 if the channel has none yet (its note-ons start nothing).
+int tsfx_note_voice_count(const tsf *p_synth, int p_preset_index, int p_key, float p_vel);
+int tsfx_channel_preset_index(const tsf *p_synth, int p_channel);
+
+// Picks the voice to steal according to p_policy, or -1 if nothing may be
+// stolen. p_channel restricts the search to one channel (negative: any).
+// p_channel_priority holds 16 priorities; voices started without a channel
+// (tsf_note_on) count as highest priority. With TSFX_STEAL_LOWEST_PRIORITY,
+// only voices whose priority is <= p_incoming_priority are candidates.
+int tsfx_pick_steal_voice(const tsf *p_synth, int p_policy, int p_channel, const int *p_channel_priority, int p_incoming_priority);
+
+// Frees a voice immediately so its slot can be reused by the next note-on.
+void tsfx_voice_kill(tsf *p_synth, int p_voice);
+
+// Disables the static low-pass filter on voices that are in their release phase.
+// Voices whose cutoff is modulated by an LFO or envelope keep their filter.
+void tsfx_drop_release_filters(tsf *p_synth);
+
+// Frees releasing voices whose current gain is below p_max_gain.
+void tsfx_kill_quiet_released_voices(tsf *p_synth, float p_max_gain);
+
+enum TsfxInterpolation {
+	TSFX_INTERP_NEAREST = 0,
+	TSFX_INTERP_LINEAR,
+	TSFX_INTERP_CUBIC,
+};
+
+// tsf_render_float() with a selectable sample interpolation. Each mode has its own
+// compile-time specialized voice kernel; TSFX_INTERP_LINEAR is TSF's own renderer.
+// Only TSF_STEREO_INTERLEAVED output is specialized, other modes fall back to TSF.
+void tsfx_render_float(tsf *p_synth, float *p_buffer, int p_samples, int p_flag_mixing, int p_interpolation);
+
+// Renders every voice once into one of p_buffer_count stereo interleaved buffers,
+// chosen by its MIDI channel through p_channel_buffer (16 entries). Voices without a
+// channel, or routed out of range, go to buffer 0. All buffers are cleared first.
+void tsfx_render_float_routed(tsf *p_synth, float *const *p_buffers, int p_buffer_count, const int *p_channel_buffer, int p_samples, int p_interpolation);
+
+// Renders each MIDI channel's voices into its own stereo interleaved buffer
+// (p_buffers[0..15]); voices without a channel go to p_buffers[16]. Returns a mask
+// of the buffers written (bit n = buffer n). Only those are cleared and valid.
+unsigned int tsfx_render_float_channels(tsf *p_synth, float *const *p_buffers, int p_samples, int p_interpolation);
+
+// Frees every voice immediately, keeping channel state (programs, controllers).
+void tsfx_kill_all_voices(tsf *p_synth);
+
+// Voice and channel state (playing voices with their envelopes, LFOs, filters and
+// sample positions; channel presets and controllers) as a flat byte block. Regions
+// are stored as indices, so a state restores into any synth loaded from the same
+// SoundFont by the same build. tsfx_state_size() is the exact size for the current
+// state; tsfx_state_save() returns the bytes written, or -1 if p_capacity is too small.
+int tsfx_state_size(const tsf *p_synth);
+int tsfx_state_save(const tsf *p_synth, unsigned char *p_buffer, int p_capacity);
+// Replaces the synth's voices and channels with a saved state. Allocates only if
+// the saved state has more voices or fewer channels than the synth. Returns 0 if
+// the block is malformed or was saved with a different SoundFont.
+int tsfx_state_load(tsf *p_synth, const unsigned char *p_buffer, int p_size);
+// Whether tsfx_state_load() would accept the block, without touching the synth.
+int tsfx_state_check(const tsf *p_synth, const unsigned char *p_buffer, int p_size);
+
+// Bytes held by the font's decoded samples and region tables. Copies made with
+// tsf_copy() share this memory with the original.
+long long tsfx_font_memory_bytes(const tsf *p_synth);
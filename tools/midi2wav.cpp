@@ -0,0 +1,167 @@
+// Batch MIDI-to-WAV renderer. One SoundFont is loaded once and shared read-only;
+// every worker thread renders whole files through its own tsf_copy(), so the
+// sample data exists once however many cores are used.
+//
+//   midi2wav --sf2 font.sf2 [--out-dir DIR] [--jobs N] [--rate HZ] [--float]
+//            [--interpolation nearest|linear|cubic] song.mid ...
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../lib/TinySoundFont/tml.h"
+#include "../lib/TinySoundFont/tsf.h"
+#include "../src/midi_smf_stream.h"
+#include "midi_render.h"
+
+namespace {
+
+std::string output_path(const std::string &p_input, const char *p_out_dir) {
+	const size_t slash = p_input.find_last_of("/\\");
+	const size_t dot = p_input.find_last_of('.');
+	const size_t stem_end = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? p_input.size() : dot;
+	if (!p_out_dir) {
+		return p_input.substr(0, stem_end) + ".wav";
+	}
+	const size_t stem_start = slash == std::string::npos ? 0 : slash + 1;
+	return std::string(p_out_dir) + "/" + p_input.substr(stem_start, stem_end - stem_start) + ".wav";
+}
+
+void print_usage() {
+	fprintf(stderr, "usage: midi2wav --sf2 font.sf2 [--out-dir DIR] [--jobs N] [--rate HZ] [--float] [--interpolation nearest|linear|cubic] song.mid ...\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	const char *sf2_path = nullptr;
+	const char *out_dir = nullptr;
+	int jobs = (int)std::thread::hardware_concurrency();
+	bool write_float = false;
+	MidiRenderSettings settings;
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--sf2") && has_value) {
+			sf2_path = argv[++i];
+		} else if (!strcmp(argv[i], "--out-dir") && has_value) {
+			out_dir = argv[++i];
+		} else if (!strcmp(argv[i], "--jobs") && has_value) {
+			jobs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--rate") && has_value) {
+			settings.sample_rate = std::max(8000, atoi(argv[++i]));
+		} else if (!strcmp(argv[i], "--float")) {
+			write_float = true;
+		} else if (!strcmp(argv[i], "--interpolation") && has_value) {
+			const char *mode = argv[++i];
+			if (!strcmp(mode, "nearest")) {
+				settings.interpolation = TSFX_INTERP_NEAREST;
+			} else if (!strcmp(mode, "linear")) {
+				settings.interpolation = TSFX_INTERP_LINEAR;
+			} else if (!strcmp(mode, "cubic")) {
+				settings.interpolation = TSFX_INTERP_CUBIC;
+			} else {
+				print_usage();
+				return 1;
+			}
+		} else if (argv[i][0] == '-') {
+			print_usage();
+			return 1;
+		} else {
+			inputs.push_back(argv[i]);
+		}
+	}
+	if (!sf2_path || inputs.empty()) {
+		print_usage();
+		return 1;
+	}
+	// Workers write in any order, so two inputs with one output path (the same stem
+	// from different directories under --out-dir) would silently keep either render.
+	std::map<std::string, size_t> output_owners;
+	for (size_t i = 0; i < inputs.size(); i++) {
+		const std::pair<std::map<std::string, size_t>::iterator, bool> owner = output_owners.emplace(output_path(inputs[i], out_dir), i);
+		if (!owner.second) {
+			fprintf(stderr, "midi2wav: %s and %s both write %s\n", inputs[owner.first->second].c_str(), inputs[i].c_str(), owner.first->first.c_str());
+			return 1;
+		}
+	}
+
+	std::vector<uint8_t> sf2_data;
+	if (!midi_read_file(sf2_path, sf2_data)) {
+		fprintf(stderr, "midi2wav: cannot read %s\n", sf2_path);
+		return 1;
+	}
+	tsf *font = tsf_load_memory(sf2_data.data(), (int)sf2_data.size());
+	if (!font) {
+		fprintf(stderr, "midi2wav: failed to load %s\n", sf2_path);
+		return 1;
+	}
+	// The font's samples are decoded now; the file bytes are no longer needed.
+	std::vector<uint8_t>().swap(sf2_data);
+
+	jobs = std::max(1, std::min(jobs, (int)inputs.size()));
+	// tsf_copy() touches the shared reference count, so all copies are made (and
+	// closed) here on the main thread; workers only read the shared samples.
+	std::vector<tsf *> synths;
+	for (int i = 0; i < jobs; i++) {
+		synths.push_back(tsf_copy(font));
+	}
+
+	std::atomic<size_t> next_input(0);
+	std::atomic<int> failures(0);
+	std::mutex print_mutex;
+	auto worker = [&](tsf *p_synth) {
+		std::vector<uint8_t> midi_data;
+		std::vector<float> output;
+		godot::MidiSmfStream stream;
+		for (size_t index = next_input++; index < inputs.size(); index = next_input++) {
+			const std::string &input = inputs[index];
+			const std::string output_file = output_path(input, out_dir);
+			const char *error = nullptr;
+
+			if (!midi_read_file(input.c_str(), midi_data)) {
+				error = "cannot read file";
+			} else if (!stream.open(midi_data.data(), midi_data.size())) {
+				error = "not a MIDI file";
+			} else {
+				// Streamed: long generated sequences never exist as a full event list.
+				midi_render_song(p_synth, stream, settings, output);
+				stream.close();
+				if (!midi_write_wav(output_file.c_str(), output.data(), (int64_t)output.size() / 2, settings.sample_rate, write_float)) {
+					error = "cannot write output";
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(print_mutex);
+			if (error) {
+				failures++;
+				fprintf(stderr, "midi2wav: %s: %s\n", input.c_str(), error);
+			} else {
+				printf("%s -> %s (%.1f s)\n", input.c_str(), output_file.c_str(), (double)output.size() / 2.0 / settings.sample_rate);
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < jobs; i++) {
+		threads.emplace_back(worker, synths[i]);
+	}
+	worker(synths[0]);
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	for (tsf *synth : synths) {
+		tsf_close(synth);
+	}
+	tsf_close(font);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,433 @@
+// Headless benchmark for the synthesis and sequencing hot paths. Links
+// TinySoundFont and the event dispatcher directly, so it runs without Godot.
+// Results are printed (or written with --out) as JSON for tracking over time.
+//
+//   midi_bench [--sf2 font.sf2] [--mid song.mid] [--out results.json] [--quick]
+//
+// Without --sf2/--mid the generated fixtures from midi_fixtures.cpp are used,
+// which keeps numbers comparable between machines and versions.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../lib/TinySoundFont/tml.h"
+#include "../lib/TinySoundFont/tsf.h"
+#include "../src/midi_dispatch.h"
+#include "../src/midi_fast_math.h"
+#include "../src/tsf_ext.h"
+#include "midi_fixtures.h"
+#include "midi_render.h"
+
+using godot::MidiEventDispatcher;
+
+namespace {
+
+constexpr int k_sample_rate = 44100;
+constexpr int k_player_block_frames = 64; // MidiPlayer's render block
+constexpr int k_fixture_bars = 64;
+constexpr int k_fixture_channels = 16;
+static const int k_voice_counts[] = { 16, 64, 256 };
+static const int k_block_sizes[] = { 64, 512 };
+static const struct {
+	const char *name;
+	int mode;
+} k_interpolations[] = {
+	{ "nearest", TSFX_INTERP_NEAREST },
+	{ "linear", TSFX_INTERP_LINEAR },
+	{ "cubic", TSFX_INTERP_CUBIC },
+};
+
+struct Timing {
+	double min_ns = 0.0;
+	double mean_ns = 0.0;
+};
+
+int64_t now_ns() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename F>
+Timing measure(int p_iterations, F p_fn) {
+	Timing t;
+	t.min_ns = 1e300;
+	double total = 0.0;
+	for (int i = 0; i < p_iterations; i++) {
+		const int64_t start = now_ns();
+		p_fn();
+		const double elapsed = (double)(now_ns() - start);
+		t.min_ns = std::min(t.min_ns, elapsed);
+		total += elapsed;
+	}
+	t.mean_ns = total / std::max(1, p_iterations);
+	return t;
+}
+
+// Stand-in for the PackedVector2Array MidiPlayer::_push_block() refills in place:
+// r_block is allocated once by the caller and overwritten one frame at a time.
+struct BenchVector2 {
+	float x, y;
+};
+
+float convert_frames(const float *p_interleaved, int p_frames, std::vector<BenchVector2> &r_block) {
+	BenchVector2 *frames = r_block.data();
+	for (int i = 0; i < p_frames; i++) {
+		frames[i] = BenchVector2{ p_interleaved[i * 2 + 0], p_interleaved[i * 2 + 1] };
+	}
+	return frames[p_frames - 1].x;
+}
+
+class JsonWriter {
+public:
+	std::string out;
+
+	void raw(const char *p_text) { out += p_text; }
+	void key(const char *p_key) {
+		comma();
+		out += '"';
+		out += p_key;
+		out += "\":";
+		pending_comma = false;
+	}
+	void begin_object() {
+		comma();
+		out += '{';
+		pending_comma = false;
+	}
+	void end_object() {
+		out += '}';
+		pending_comma = true;
+	}
+	void begin_array() {
+		comma();
+		out += '[';
+		pending_comma = false;
+	}
+	void end_array() {
+		out += ']';
+		pending_comma = true;
+	}
+	void number(double p_value) {
+		comma();
+		char buf[64];
+		snprintf(buf, sizeof(buf), "%.6g", p_value);
+		out += buf;
+		pending_comma = true;
+	}
+	void string(const char *p_value) {
+		comma();
+		out += '"';
+		for (const char *c = p_value; *c; c++) {
+			if (*c == '"' || *c == '\\') {
+				out += '\\';
+			}
+			out += *c;
+		}
+		out += '"';
+		pending_comma = true;
+	}
+	void field(const char *p_key, double p_value) {
+		key(p_key);
+		number(p_value);
+	}
+	void field(const char *p_key, const char *p_value) {
+		key(p_key);
+		string(p_value);
+	}
+
+private:
+	bool pending_comma = false;
+
+	void comma() {
+		if (pending_comma) {
+			out += ',';
+			pending_comma = false;
+		}
+	}
+};
+
+void write_timing(JsonWriter &p_json, const char *p_key, const Timing &p_timing, int p_iterations) {
+	p_json.key(p_key);
+	p_json.begin_object();
+	p_json.field("iterations", p_iterations);
+	p_json.field("min_us", p_timing.min_ns / 1000.0);
+	p_json.field("mean_us", p_timing.mean_ns / 1000.0);
+	p_json.end_object();
+}
+
+void bench_render(JsonWriter &p_json, tsf *p_font, bool p_quick) {
+	const int frames_total = p_quick ? k_sample_rate / 2 : k_sample_rate * 4;
+
+	p_json.key("render");
+	p_json.begin_array();
+	for (const auto &interp : k_interpolations) {
+		for (int voices : k_voice_counts) {
+			for (int block : k_block_sizes) {
+				tsf *synth = tsf_copy(p_font);
+				midi_configure_synth(synth, k_sample_rate, voices);
+				// The fixture loops forever, so every voice stays active for the whole run.
+				for (int i = 0; i < voices; i++) {
+					tsf_note_on(synth, 0, 36 + (i * 7) % 60, 0.5f);
+				}
+				const int active = tsf_active_voice_count(synth);
+
+				std::vector<float> buffer((size_t)block * 2);
+				const int64_t start = now_ns();
+				for (int done = 0; done < frames_total; done += block) {
+					tsfx_render_float(synth, buffer.data(), block, 0, interp.mode);
+				}
+				const double sec = (double)(now_ns() - start) * 1e-9;
+				tsf_close(synth);
+
+				const double frames_per_sec = frames_total / sec;
+				p_json.begin_object();
+				p_json.field("interpolation", interp.name);
+				p_json.field("voices", active);
+				p_json.field("block_frames", block);
+				p_json.field("frames_per_sec", frames_per_sec);
+				p_json.field("voice_frames_per_sec", frames_per_sec * active);
+				p_json.field("realtime_factor", frames_per_sec / k_sample_rate);
+				p_json.end_object();
+			}
+		}
+	}
+	p_json.end_array();
+}
+
+void bench_dispatch(JsonWriter &p_json, tsf *p_font, const tml_message *p_midi, bool p_quick) {
+	int events = 0;
+	for (const tml_message *m = p_midi; m; m = m->next) {
+		events++;
+	}
+	const int iterations = p_quick ? 5 : 50;
+
+	tsf *synth = tsf_copy(p_font);
+	midi_configure_synth(synth, k_sample_rate, 256);
+	MidiEventDispatcher dispatcher;
+	// Low enough that the dense fixture keeps the steal path busy.
+	dispatcher.voice_cap = 64;
+
+	p_json.key("dispatch");
+	p_json.begin_object();
+	p_json.field("events", events);
+	p_json.field("voice_cap", dispatcher.voice_cap);
+	for (int silent = 0; silent < 2; silent++) {
+		const Timing t = measure(iterations, [&]() {
+			tsfx_kill_all_voices(synth);
+			dispatcher.clear_held_notes();
+			dispatcher.process_until(synth, p_midi, UINT32_MAX, silent != 0);
+		});
+		p_json.field(silent ? "silent_ns_per_event" : "ns_per_event", t.min_ns / std::max(1, events));
+	}
+	p_json.end_object();
+	tsf_close(synth);
+}
+
+void bench_conversion(JsonWriter &p_json, bool p_quick) {
+	const int block = 512;
+	const int iterations = p_quick ? 2000 : 20000;
+	std::vector<float> interleaved((size_t)block * 2, 0.25f);
+	std::vector<BenchVector2> converted(block);
+	volatile float sink = 0.0f;
+
+	const int64_t start = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		sink = sink + convert_frames(interleaved.data(), block, converted);
+	}
+	const double ns = (double)(now_ns() - start);
+
+	p_json.key("vector2_conversion");
+	p_json.begin_object();
+	p_json.field("block_frames", block);
+	p_json.field("ns_per_frame", ns / ((double)iterations * block));
+	p_json.end_object();
+}
+
+// The synth's control-rate math: libm against the approximations compiled into
+// the synth, with the worst relative error over the ranges it uses.
+void bench_fast_math(JsonWriter &p_json, bool p_quick) {
+	const int count = 4096;
+	const int iterations = p_quick ? 200 : 2000;
+	std::vector<float> decibels(count);
+	std::vector<float> timecents(count);
+	for (int i = 0; i < count; i++) {
+		decibels[i] = -100.0f + 124.0f * (float)i / count;
+		timecents[i] = -12000.0f + 26000.0f * (float)i / count;
+	}
+
+	double gain_error = 0.0;
+	double pitch_error = 0.0;
+	for (int i = 0; i < count; i++) {
+		const double gain = std::pow(10.0, decibels[i] * 0.05);
+		gain_error = std::max(gain_error, std::fabs(godot::midi_fast_powf(10.0f, decibels[i] * 0.05f) - gain) / gain);
+		const double ratio = std::pow(2.0, timecents[i] / 1200.0);
+		pitch_error = std::max(pitch_error, std::fabs(godot::midi_fast_pow(2.0, timecents[i] / 1200.0) - ratio) / ratio);
+	}
+
+	volatile float sink = 0.0f;
+	int64_t start = now_ns();
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < count; i++) {
+			sink = sink + std::pow(10.0f, decibels[i] * 0.05f) + (float)std::pow(2.0, timecents[i] / 1200.0);
+		}
+	}
+	const double libm_ns = (double)(now_ns() - start);
+	start = now_ns();
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < count; i++) {
+			sink = sink + godot::midi_fast_powf(10.0f, decibels[i] * 0.05f) + (float)godot::midi_fast_pow(2.0, timecents[i] / 1200.0);
+		}
+	}
+	const double fast_ns = (double)(now_ns() - start);
+
+	p_json.key("fast_math");
+	p_json.begin_object();
+	p_json.field("libm_ns_per_pair", libm_ns / ((double)iterations * count));
+	p_json.field("fast_ns_per_pair", fast_ns / ((double)iterations * count));
+	p_json.field("max_gain_rel_error", gain_error);
+	p_json.field("max_pitch_rel_error", pitch_error);
+	p_json.end_object();
+}
+
+// The whole player loop: dispatch, render and convert in MidiPlayer-sized blocks.
+void bench_song(JsonWriter &p_json, tsf *p_font, const tml_message *p_midi) {
+	uint32_t length_ms = 0;
+	for (const tml_message *m = p_midi; m; m = m->next) {
+		length_ms = std::max(length_ms, m->time);
+	}
+
+	tsf *synth = tsf_copy(p_font);
+	midi_configure_synth(synth, k_sample_rate, 256);
+	MidiEventDispatcher dispatcher;
+	std::vector<float> buffer((size_t)k_player_block_frames * 2);
+	std::vector<BenchVector2> converted(k_player_block_frames);
+	const tml_message *cursor = p_midi;
+	volatile float sink = 0.0f;
+	int peak_voices = 0;
+	int64_t frames = 0;
+
+	const int64_t start = now_ns();
+	while (cursor || tsf_active_voice_count(synth) > 0) {
+		const uint32_t time_ms = (uint32_t)(frames * 1000 / k_sample_rate);
+		cursor = dispatcher.process_until(synth, cursor, time_ms, false);
+		tsf_render_float(synth, buffer.data(), k_player_block_frames, 0);
+		sink = sink + convert_frames(buffer.data(), k_player_block_frames, converted);
+		peak_voices = std::max(peak_voices, tsf_active_voice_count(synth));
+		frames += k_player_block_frames;
+		if (frames > (int64_t)(length_ms + 10000) * k_sample_rate / 1000) {
+			break; // hanging notes in a user supplied file
+		}
+	}
+	const double sec = (double)(now_ns() - start) * 1e-9;
+	tsf_close(synth);
+
+	p_json.key("song");
+	p_json.begin_object();
+	p_json.field("length_sec", length_ms / 1000.0);
+	p_json.field("rendered_sec", (double)frames / k_sample_rate);
+	p_json.field("block_frames", k_player_block_frames);
+	p_json.field("peak_voices", peak_voices);
+	p_json.field("realtime_factor", ((double)frames / k_sample_rate) / sec);
+	p_json.end_object();
+}
+
+void print_usage() {
+	fprintf(stderr, "usage: midi_bench [--sf2 font.sf2] [--mid song.mid] [--out results.json] [--quick]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	const char *sf2_path = nullptr;
+	const char *mid_path = nullptr;
+	const char *out_path = nullptr;
+	bool quick = false;
+
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--sf2") && has_value) {
+			sf2_path = argv[++i];
+		} else if (!strcmp(argv[i], "--mid") && has_value) {
+			mid_path = argv[++i];
+		} else if (!strcmp(argv[i], "--out") && has_value) {
+			out_path = argv[++i];
+		} else if (!strcmp(argv[i], "--quick")) {
+			quick = true;
+		} else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	std::vector<uint8_t> sf2_data;
+	std::vector<uint8_t> mid_data;
+	if (sf2_path) {
+		if (!midi_read_file(sf2_path, sf2_data)) {
+			fprintf(stderr, "midi_bench: cannot read %s\n", sf2_path);
+			return 1;
+		}
+	} else {
+		sf2_data = midi_fixture_make_sf2();
+	}
+	if (mid_path) {
+		if (!midi_read_file(mid_path, mid_data)) {
+			fprintf(stderr, "midi_bench: cannot read %s\n", mid_path);
+			return 1;
+		}
+	} else {
+		mid_data = midi_fixture_make_smf(k_fixture_bars, k_fixture_channels);
+	}
+
+	tsf *font = tsf_load_memory(sf2_data.data(), (int)sf2_data.size());
+	tml_message *midi = tml_load_memory(mid_data.data(), (int)mid_data.size());
+	if (!font || !midi) {
+		fprintf(stderr, "midi_bench: failed to load %s\n", !font ? "SoundFont" : "MIDI file");
+		return 1;
+	}
+
+	JsonWriter json;
+	json.begin_object();
+	json.field("sample_rate", k_sample_rate);
+	json.field("quick", quick ? 1 : 0);
+	json.field("sf2", sf2_path ? sf2_path : "fixture");
+	json.field("midi", mid_path ? mid_path : "fixture");
+
+	const int load_iterations = quick ? 5 : 50;
+	write_timing(json, "sf2_load", measure(load_iterations, [&]() {
+		tsf_close(tsf_load_memory(sf2_data.data(), (int)sf2_data.size()));
+	}),
+			load_iterations);
+	write_timing(json, "midi_parse", measure(load_iterations, [&]() {
+		tml_free(tml_load_memory(mid_data.data(), (int)mid_data.size()));
+	}),
+			load_iterations);
+
+	bench_render(json, font, quick);
+	bench_dispatch(json, font, midi, quick);
+	bench_conversion(json, quick);
+	bench_fast_math(json, quick);
+	bench_song(json, font, midi);
+	json.end_object();
+	json.raw("\n");
+
+	tml_free(midi);
+	tsf_close(font);
+
+	if (out_path) {
+		FILE *f = fopen(out_path, "wb");
+		if (!f) {
+			fprintf(stderr, "midi_bench: cannot write %s\n", out_path);
+			return 1;
+		}
+		fwrite(json.out.data(), 1, json.out.size(), f);
+		fclose(f);
+	} else {
+		fputs(json.out.c_str(), stdout);
+	}
+	return 0;
+}
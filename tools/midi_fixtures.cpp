@@ -0,0 +1,337 @@
+#include "midi_fixtures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace {
+
+constexpr double k_pi = 3.14159265358979323846;
+constexpr int k_sample_rate = 44100;
+constexpr int k_sine_period = 100; // 441 Hz, close enough to A4
+constexpr int k_sine_cycles = 20;
+constexpr int k_sample_padding = 46; // zero samples the spec requires after each sample
+constexpr int k_ticks_per_beat = 480;
+
+class ByteWriter {
+public:
+	std::vector<uint8_t> data;
+
+	void u8(uint32_t p_value) { data.push_back((uint8_t)p_value); }
+	void u16le(uint32_t p_value) {
+		u8(p_value);
+		u8(p_value >> 8);
+	}
+	void u32le(uint32_t p_value) {
+		u16le(p_value);
+		u16le(p_value >> 16);
+	}
+	void u16be(uint32_t p_value) {
+		u8(p_value >> 8);
+		u8(p_value);
+	}
+	void u32be(uint32_t p_value) {
+		u16be(p_value >> 16);
+		u16be(p_value);
+	}
+	void tag(const char *p_fourcc) { data.insert(data.end(), p_fourcc, p_fourcc + 4); }
+	void name(const char *p_name, size_t p_size) {
+		const size_t len = std::min(strlen(p_name), p_size);
+		data.insert(data.end(), p_name, p_name + len);
+		data.insert(data.end(), p_size - len, 0);
+	}
+	void bytes(const std::vector<uint8_t> &p_bytes) { data.insert(data.end(), p_bytes.begin(), p_bytes.end()); }
+	void vlq(uint32_t p_value) {
+		uint8_t buf[5];
+		int n = 0;
+		buf[n++] = p_value & 0x7F;
+		while (p_value >>= 7) {
+			buf[n++] = (uint8_t)(0x80 | (p_value & 0x7F));
+		}
+		while (n--) {
+			u8(buf[n]);
+		}
+	}
+};
+
+std::vector<uint8_t> riff_chunk(const char *p_id, const std::vector<uint8_t> &p_body) {
+	ByteWriter w;
+	w.tag(p_id);
+	w.u32le((uint32_t)p_body.size());
+	w.bytes(p_body);
+	if (p_body.size() & 1) {
+		w.u8(0);
+	}
+	return w.data;
+}
+
+std::vector<uint8_t> riff_list(const char *p_type, const std::vector<uint8_t> &p_chunks) {
+	ByteWriter w;
+	w.tag(p_type);
+	w.bytes(p_chunks);
+	return riff_chunk("LIST", w.data);
+}
+
+struct SmfEvent {
+	uint32_t tick;
+	int order; // note-offs sort before note-ons on the same tick
+	std::vector<uint8_t> bytes;
+};
+
+// Format 0 at 120 BPM, ending p_tail_ticks after the last event.
+std::vector<uint8_t> write_smf(std::vector<SmfEvent> &r_events, uint32_t p_tail_ticks) {
+	std::stable_sort(r_events.begin(), r_events.end(), [](const SmfEvent &a, const SmfEvent &b) {
+		return a.tick != b.tick ? a.tick < b.tick : a.order < b.order;
+	});
+
+	ByteWriter track;
+	track.vlq(0);
+	track.bytes({ 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20 }); // 500000 us per beat
+	uint32_t last_tick = 0;
+	for (const SmfEvent &e : r_events) {
+		track.vlq(e.tick - last_tick);
+		track.bytes(e.bytes);
+		last_tick = e.tick;
+	}
+	track.vlq(p_tail_ticks);
+	track.bytes({ 0xFF, 0x2F, 0x00 });
+
+	ByteWriter smf;
+	smf.tag("MThd");
+	smf.u32be(6);
+	smf.u16be(0);
+	smf.u16be(1);
+	smf.u16be(k_ticks_per_beat);
+	smf.tag("MTrk");
+	smf.u32be((uint32_t)track.data.size());
+	smf.bytes(track.data);
+	return smf.data;
+}
+
+} // namespace
+
+std::vector<uint8_t> midi_fixture_make_sf2() {
+	ByteWriter info;
+	{
+		ByteWriter ifil;
+		ifil.u16le(2);
+		ifil.u16le(1);
+		info.bytes(riff_chunk("ifil", ifil.data));
+		info.bytes(riff_chunk("isng", std::vector<uint8_t>{ 'E', 'M', 'U', '8', '0', '0', '0', 0 }));
+		info.bytes(riff_chunk("INAM", std::vector<uint8_t>{ 'b', 'e', 'n', 'c', 'h', 0 }));
+	}
+
+	const int sample_frames = k_sine_period * k_sine_cycles;
+	ByteWriter smpl;
+	for (int i = 0; i < sample_frames; i++) {
+		const double phase = 2.0 * k_pi * (double)i / (double)k_sine_period;
+		smpl.u16le((uint16_t)(int16_t)std::lround(std::sin(phase) * 16000.0));
+	}
+	for (int i = 0; i < k_sample_padding; i++) {
+		smpl.u16le(0);
+	}
+
+	ByteWriter phdr;
+	phdr.name("Sine", 20);
+	phdr.u16le(0); // preset
+	phdr.u16le(0); // bank
+	phdr.u16le(0); // bag index
+	phdr.u32le(0);
+	phdr.u32le(0);
+	phdr.u32le(0);
+	phdr.name("EOP", 20);
+	phdr.u16le(0);
+	phdr.u16le(0);
+	phdr.u16le(1);
+	phdr.u32le(0);
+	phdr.u32le(0);
+	phdr.u32le(0);
+
+	ByteWriter pbag;
+	pbag.u16le(0);
+	pbag.u16le(0);
+	pbag.u16le(1);
+	pbag.u16le(0);
+
+	ByteWriter pgen;
+	pgen.u16le(41); // instrument
+	pgen.u16le(0);
+	pgen.u16le(0);
+	pgen.u16le(0);
+
+	ByteWriter inst;
+	inst.name("Sine", 20);
+	inst.u16le(0);
+	inst.name("EOI", 20);
+	inst.u16le(1);
+
+	ByteWriter ibag;
+	ibag.u16le(0);
+	ibag.u16le(0);
+	ibag.u16le(3);
+	ibag.u16le(0);
+
+	ByteWriter igen;
+	igen.u16le(54); // sampleModes: continuous loop
+	igen.u16le(1);
+	igen.u16le(38); // releaseVolEnv: ~0.3 s
+	igen.u16le((uint16_t)(int16_t)-2084);
+	igen.u16le(53); // sampleID, always last
+	igen.u16le(0);
+	igen.u16le(0);
+	igen.u16le(0);
+
+	// Empty modulator lists still need their terminal record.
+	const std::vector<uint8_t> no_mods(10, 0);
+
+	ByteWriter shdr;
+	shdr.name("Sine", 20);
+	shdr.u32le(0);
+	shdr.u32le((uint32_t)sample_frames);
+	shdr.u32le(0);
+	shdr.u32le((uint32_t)sample_frames);
+	shdr.u32le(k_sample_rate);
+	shdr.u8(69); // original pitch
+	shdr.u8(0);
+	shdr.u16le(0);
+	shdr.u16le(1); // mono
+	shdr.name("EOS", 20);
+	for (int i = 0; i < 5; i++) {
+		shdr.u32le(0);
+	}
+	shdr.u8(0);
+	shdr.u8(0);
+	shdr.u16le(0);
+	shdr.u16le(0);
+
+	ByteWriter pdta;
+	pdta.bytes(riff_chunk("phdr", phdr.data));
+	pdta.bytes(riff_chunk("pbag", pbag.data));
+	pdta.bytes(riff_chunk("pmod", no_mods));
+	pdta.bytes(riff_chunk("pgen", pgen.data));
+	pdta.bytes(riff_chunk("inst", inst.data));
+	pdta.bytes(riff_chunk("ibag", ibag.data));
+	pdta.bytes(riff_chunk("imod", no_mods));
+	pdta.bytes(riff_chunk("igen", igen.data));
+	pdta.bytes(riff_chunk("shdr", shdr.data));
+
+	ByteWriter body;
+	body.tag("sfbk");
+	body.bytes(riff_list("INFO", info.data));
+	body.bytes(riff_list("sdta", riff_chunk("smpl", smpl.data)));
+	body.bytes(riff_list("pdta", pdta.data));
+	return riff_chunk("RIFF", body.data);
+}
+
+std::vector<uint8_t> midi_fixture_make_smf(int p_bars, int p_channels) {
+	std::vector<SmfEvent> events;
+	auto add = [&](uint32_t p_tick, int p_order, std::initializer_list<uint8_t> p_bytes) {
+		events.push_back(SmfEvent{ p_tick, p_order, std::vector<uint8_t>(p_bytes) });
+	};
+	auto note = [&](uint32_t p_tick, uint32_t p_length, int p_channel, int p_key, int p_velocity) {
+		add(p_tick, 1, { (uint8_t)(0x90 | p_channel), (uint8_t)p_key, (uint8_t)p_velocity });
+		add(p_tick + p_length, 0, { (uint8_t)(0x80 | p_channel), (uint8_t)p_key, 0 });
+	};
+
+	const int channels = std::max(1, std::min(16, p_channels));
+	const uint32_t beat = k_ticks_per_beat;
+	const uint32_t bar = beat * 4;
+	static const int chord_roots[4] = { 48, 53, 55, 50 };
+
+	for (int ch = 0; ch < channels; ch++) {
+		add(0, 2, { (uint8_t)(0xC0 | ch), 0 });
+		add(0, 2, { (uint8_t)(0xB0 | ch), 7, 100 });
+	}
+
+	for (int b = 0; b < p_bars; b++) {
+		const uint32_t bar_tick = (uint32_t)b * bar;
+		const int root = chord_roots[b % 4];
+		for (int ch = 0; ch < channels; ch++) {
+			if (ch == 9) {
+				// Drums: eighth-note hats, kick and snare on the beats.
+				for (int i = 0; i < 8; i++) {
+					note(bar_tick + i * beat / 2, beat / 4, ch, 42, 70 + (i & 1) * 20);
+				}
+				for (int i = 0; i < 4; i++) {
+					note(bar_tick + i * beat, beat / 4, ch, (i & 1) ? 38 : 36, 110);
+				}
+				continue;
+			}
+			switch (ch % 3) {
+				case 0: // sustained chord
+					for (int k : { 0, 4, 7, 11 }) {
+						note(bar_tick, bar - beat / 8, ch, root + 12 * (ch / 3 % 2) + k, 80);
+					}
+					break;
+				case 1: // sixteenth-note run
+					for (int i = 0; i < 16; i++) {
+						note(bar_tick + i * beat / 4, beat / 4 - 10, ch, root + 24 + (i * 5) % 12, 60 + (i % 4) * 15);
+					}
+					break;
+				default: // bass with a pitch bend and an expression sweep
+					note(bar_tick, beat * 2, ch, root - 12, 100);
+					note(bar_tick + beat * 2, beat * 2, ch, root - 5, 100);
+					for (int i = 0; i < 8; i++) {
+						const int bend = 8192 + (int)(std::sin(i * 0.8) * 2000.0);
+						add(bar_tick + i * beat / 2, 2, { (uint8_t)(0xE0 | ch), (uint8_t)(bend & 0x7F), (uint8_t)(bend >> 7) });
+						add(bar_tick + i * beat / 2, 2, { (uint8_t)(0xB0 | ch), 11, (uint8_t)(64 + i * 8) });
+					}
+					break;
+			}
+		}
+	}
+
+	return write_smf(events, bar);
+}
+
+std::vector<uint8_t> midi_fixture_make_pedal_smf(int p_bars) {
+	std::vector<SmfEvent> events;
+	auto add = [&](uint32_t p_tick, int p_order, std::initializer_list<uint8_t> p_bytes) {
+		events.push_back(SmfEvent{ p_tick, p_order, std::vector<uint8_t>(p_bytes) });
+	};
+	auto cc = [&](uint32_t p_tick, int p_channel, int p_control, int p_value) {
+		add(p_tick, 2, { (uint8_t)(0xB0 | p_channel), (uint8_t)p_control, (uint8_t)p_value });
+	};
+
+	const uint32_t beat = k_ticks_per_beat;
+	const uint32_t bar = beat * 4;
+	for (int b = 0; b < p_bars; b++) {
+		const uint32_t bar_tick = (uint32_t)b * bar;
+		for (int i = 0; i < 4; i++) {
+			for (int k : { 60, 64, 67 }) {
+				add(bar_tick + i * beat, 1, { 0x90, (uint8_t)(k + b % 5), 90 });
+				add(bar_tick + i * beat + beat / 2, 0, { 0x80, (uint8_t)(k + b % 5), 0 });
+			}
+			add(bar_tick + i * beat + 3, 1, { 0x91, 48, 100 });
+			add(bar_tick + i * beat + beat - 20, 0, { 0x81, 48, 0 });
+		}
+
+		// Sustain: pedal changes a tick apart, a half-pedal wobble across the
+		// 64 threshold, and repeats that carry no information.
+		cc(bar_tick + 1, 0, 64, 127);
+		cc(bar_tick + 2, 0, 64, 127);
+		cc(bar_tick + beat * 2 - 2, 0, 64, 0);
+		cc(bar_tick + beat * 2 - 1, 0, 64, 127);
+		for (int i = 0; i < 8; i++) {
+			cc(bar_tick + beat * 3 + i * 2, 0, 64, (i & 1) ? 64 : 63);
+		}
+		cc(bar_tick + bar - 1, 0, 64, 0);
+
+		// The other switches, toggled close together on the second channel.
+		for (int control = 65; control <= 69; control++) {
+			cc(bar_tick + (uint32_t)(control - 64) * 5, 1, control, 127);
+			cc(bar_tick + (uint32_t)(control - 64) * 5 + 1, 1, control, 0);
+			cc(bar_tick + beat * 2 + (uint32_t)(control - 64), 1, control, 64);
+		}
+
+		// Dense continuous data for the thinning to work on around the pedals.
+		for (int i = 0; i < 64; i++) {
+			const uint32_t tick = bar_tick + (uint32_t)i * (bar / 64);
+			cc(tick, 0, 1, 40 + (i % 32));
+			const int bend = 8192 + (int)(std::sin(i * 0.2) * 1500.0);
+			add(tick, 2, { 0xE0, (uint8_t)(bend & 0x7F), (uint8_t)(bend >> 7) });
+		}
+	}
+	return write_smf(events, bar);
+}
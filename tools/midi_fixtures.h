@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Test assets generated in code so the native tools need no binary fixtures:
+// a one-preset SoundFont with a looping sine, a dense multi-channel SMF and a
+// pedal-heavy SMF for the optimizer check.
+
+// SoundFont 2 with preset 0 (bank 0) playing a looped sine over the whole key range.
+std::vector<uint8_t> midi_fixture_make_sf2();
+
+// Format 0 SMF at 120 BPM: p_bars bars of 4/4 with chords, runs, controller
+// sweeps and pitch bends on p_channels channels (drums on channel 9 when included).
+std::vector<uint8_t> midi_fixture_make_smf(int p_bars, int p_channels);
+
+// Format 0 SMF at 120 BPM: p_bars bars of notes on two channels with sustain
+// pedal moves a tick apart, half-pedal wobble across the on/off threshold, the
+// other CC65-69 switches, and dense modulation and pitch-bend sweeps around them.
+std::vector<uint8_t> midi_fixture_make_pedal_smf(int p_bars);
@@ -0,0 +1,293 @@
+// Golden-output regression harness for the render path. Renders a corpus through
+// the same dispatch and block loop as MidiPlayer and compares each result with
+// a recorded baseline: an exact hash of the float output first, then the RMS
+// difference against the stored reference WAV. Render times are recorded too,
+// so a slowdown can fail the run alongside a change in sound.
+//
+//   midi_golden --golden DIR --record [--sf2 font.sf2] [song.mid ...]
+//   midi_golden --golden DIR [--sf2 font.sf2] [--tolerance 1e-4] [--max-slowdown 1.5] [song.mid ...]
+//
+// The generated fixtures are always part of the corpus; record the baseline
+// from a build whose output is known to be good.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../lib/TinySoundFont/tml.h"
+#include "../lib/TinySoundFont/tsf.h"
+#include "midi_fixtures.h"
+#include "midi_render.h"
+
+namespace {
+
+struct GoldenCase {
+	std::string name;
+	std::vector<uint8_t> midi_data;
+	MidiRenderSettings settings;
+};
+
+struct GoldenEntry {
+	uint64_t hash = 0;
+	int64_t frames = 0;
+	double render_ms = 0.0;
+};
+
+const char *k_manifest_name = "golden.txt";
+
+uint64_t hash_samples(const std::vector<float> &p_samples) {
+	// FNV-1a over the raw float bits: any change at all shows up.
+	uint64_t hash = 14695981039346656037ull;
+	const uint8_t *bytes = (const uint8_t *)p_samples.data();
+	const size_t size = p_samples.size() * sizeof(float);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+double rms_difference(const std::vector<float> &p_a, const std::vector<float> &p_b) {
+	double sum = 0.0;
+	for (size_t i = 0; i < p_a.size(); i++) {
+		const double d = (double)p_a[i] - (double)p_b[i];
+		sum += d * d;
+	}
+	return p_a.empty() ? 0.0 : std::sqrt(sum / (double)p_a.size());
+}
+
+std::string case_name_from_path(const std::string &p_path) {
+	const size_t slash = p_path.find_last_of("/\\");
+	std::string name = slash == std::string::npos ? p_path : p_path.substr(slash + 1);
+	const size_t dot = name.find_last_of('.');
+	return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+void add_fixture_cases(std::vector<GoldenCase> &r_cases) {
+	const std::vector<uint8_t> dense = midi_fixture_make_smf(32, 16);
+	static const struct {
+		const char *name;
+		int interpolation;
+	} interpolations[] = {
+		{ "fixture_dense_nearest", TSFX_INTERP_NEAREST },
+		{ "fixture_dense_linear", TSFX_INTERP_LINEAR },
+		{ "fixture_dense_cubic", TSFX_INTERP_CUBIC },
+	};
+	for (const auto &interp : interpolations) {
+		GoldenCase c;
+		c.name = interp.name;
+		c.midi_data = dense;
+		c.settings.interpolation = interp.interpolation;
+		r_cases.push_back(c);
+	}
+
+	// Tight voice caps keep every steal policy busy.
+	static const struct {
+		const char *name;
+		int policy;
+	} policies[] = {
+		{ "fixture_steal_oldest", TSFX_STEAL_OLDEST },
+		{ "fixture_steal_quietest", TSFX_STEAL_QUIETEST },
+		{ "fixture_steal_released_first", TSFX_STEAL_RELEASED_FIRST },
+	};
+	const std::vector<uint8_t> short_song = midi_fixture_make_smf(8, 16);
+	for (const auto &policy : policies) {
+		GoldenCase c;
+		c.name = policy.name;
+		c.midi_data = short_song;
+		c.settings.max_voices = 24;
+		c.settings.steal_policy = policy.policy;
+		r_cases.push_back(c);
+	}
+}
+
+bool load_manifest(const std::string &p_path, std::string &r_font, std::map<std::string, GoldenEntry> &r_entries) {
+	FILE *f = fopen(p_path.c_str(), "r");
+	if (!f) {
+		return false;
+	}
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, "# sf2 ", 6)) {
+			r_font = line + 6;
+			while (!r_font.empty() && (r_font.back() == '\n' || r_font.back() == '\r')) {
+				r_font.pop_back();
+			}
+			continue;
+		}
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+		char name[512];
+		unsigned long long hash = 0;
+		long long frames = 0;
+		double render_ms = 0.0;
+		if (sscanf(line, "%511s %llx %lld %lf", name, &hash, &frames, &render_ms) == 4) {
+			r_entries[name] = GoldenEntry{ (uint64_t)hash, (int64_t)frames, render_ms };
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+void print_usage() {
+	fprintf(stderr, "usage: midi_golden --golden DIR [--record] [--sf2 font.sf2] [--tolerance RMS] [--max-slowdown FACTOR] [song.mid ...]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	const char *golden_dir = nullptr;
+	const char *sf2_path = nullptr;
+	bool record = false;
+	double tolerance = 1e-4;
+	double max_slowdown = 0.0; // 0 = timings are reported but never fail the run
+	std::vector<GoldenCase> cases;
+	add_fixture_cases(cases);
+
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--golden") && has_value) {
+			golden_dir = argv[++i];
+		} else if (!strcmp(argv[i], "--sf2") && has_value) {
+			sf2_path = argv[++i];
+		} else if (!strcmp(argv[i], "--record")) {
+			record = true;
+		} else if (!strcmp(argv[i], "--tolerance") && has_value) {
+			tolerance = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--max-slowdown") && has_value) {
+			max_slowdown = atof(argv[++i]);
+		} else if (argv[i][0] == '-') {
+			print_usage();
+			return 1;
+		} else {
+			GoldenCase c;
+			c.name = case_name_from_path(argv[i]);
+			if (!midi_read_file(argv[i], c.midi_data)) {
+				fprintf(stderr, "midi_golden: cannot read %s\n", argv[i]);
+				return 1;
+			}
+			cases.push_back(c);
+		}
+	}
+	if (!golden_dir) {
+		print_usage();
+		return 1;
+	}
+
+	std::vector<uint8_t> sf2_data;
+	if (sf2_path) {
+		if (!midi_read_file(sf2_path, sf2_data)) {
+			fprintf(stderr, "midi_golden: cannot read %s\n", sf2_path);
+			return 1;
+		}
+	} else {
+		sf2_data = midi_fixture_make_sf2();
+	}
+	tsf *font = tsf_load_memory(sf2_data.data(), (int)sf2_data.size());
+	if (!font) {
+		fprintf(stderr, "midi_golden: failed to load SoundFont\n");
+		return 1;
+	}
+	const std::string font_name = sf2_path ? case_name_from_path(sf2_path) : "fixture";
+	const std::string manifest_path = std::string(golden_dir) + "/" + k_manifest_name;
+
+	std::map<std::string, GoldenEntry> golden;
+	std::string golden_font;
+	if (!record) {
+		if (!load_manifest(manifest_path, golden_font, golden)) {
+			fprintf(stderr, "midi_golden: no baseline at %s (run with --record first)\n", manifest_path.c_str());
+			tsf_close(font);
+			return 1;
+		}
+		if (golden_font != font_name) {
+			fprintf(stderr, "midi_golden: baseline was recorded with SoundFont '%s', not '%s'\n", golden_font.c_str(), font_name.c_str());
+			tsf_close(font);
+			return 1;
+		}
+	}
+
+	FILE *manifest = nullptr;
+	if (record) {
+		manifest = fopen(manifest_path.c_str(), "w");
+		if (!manifest) {
+			fprintf(stderr, "midi_golden: cannot write %s\n", manifest_path.c_str());
+			tsf_close(font);
+			return 1;
+		}
+		fprintf(manifest, "# midi_golden baseline: name hash frames render_ms\n# sf2 %s\n", font_name.c_str());
+	}
+
+	tsf *synth = tsf_copy(font);
+	int failures = 0;
+	std::vector<float> output;
+	for (const GoldenCase &c : cases) {
+		tml_message *midi = tml_load_memory(c.midi_data.data(), (int)c.midi_data.size());
+		if (!midi) {
+			printf("%-32s FAIL  cannot parse MIDI\n", c.name.c_str());
+			failures++;
+			continue;
+		}
+		const auto start = std::chrono::steady_clock::now();
+		midi_render_song(synth, midi, c.settings, output);
+		const double render_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		tml_free(midi);
+
+		const int64_t frames = (int64_t)output.size() / 2;
+		const uint64_t hash = hash_samples(output);
+		const std::string wav_path = std::string(golden_dir) + "/" + c.name + ".wav";
+
+		if (record) {
+			if (!midi_write_wav(wav_path.c_str(), output.data(), frames, c.settings.sample_rate, true)) {
+				fprintf(stderr, "midi_golden: cannot write %s\n", wav_path.c_str());
+				failures++;
+				continue;
+			}
+			fprintf(manifest, "%s %016llx %lld %.3f\n", c.name.c_str(), (unsigned long long)hash, (long long)frames, render_ms);
+			printf("%-32s REC   %lld frames  %.1f ms\n", c.name.c_str(), (long long)frames, render_ms);
+			continue;
+		}
+
+		const auto it = golden.find(c.name);
+		if (it == golden.end()) {
+			printf("%-32s FAIL  not in baseline\n", c.name.c_str());
+			failures++;
+			continue;
+		}
+		const GoldenEntry &entry = it->second;
+		const char *status = "OK";
+		double rms = 0.0;
+		if (hash != entry.hash) {
+			std::vector<float> reference;
+			int reference_rate = 0;
+			if (frames != entry.frames || !midi_read_wav(wav_path.c_str(), reference, reference_rate) || reference.size() != output.size()) {
+				printf("%-32s FAIL  length %lld, baseline %lld\n", c.name.c_str(), (long long)frames, (long long)entry.frames);
+				failures++;
+				continue;
+			}
+			rms = rms_difference(output, reference);
+			status = rms <= tolerance ? "OK~" : "FAIL";
+		}
+		const bool slow = max_slowdown > 0.0 && entry.render_ms > 0.0 && render_ms > entry.render_ms * max_slowdown;
+		if (slow && strcmp(status, "FAIL")) {
+			status = "SLOW";
+		}
+		if (strcmp(status, "OK") && strcmp(status, "OK~")) {
+			failures++;
+		}
+		printf("%-32s %-5s rms %.3g  %.1f ms (baseline %.1f ms)%s\n", c.name.c_str(), status, rms, render_ms, entry.render_ms, slow ? "  slower than allowed" : "");
+	}
+
+	tsf_close(synth);
+	tsf_close(font);
+	if (manifest) {
+		fclose(manifest);
+	}
+	printf("%d case(s), %d failure(s)\n", (int)cases.size(), failures);
+	return failures ? 1 : 0;
+}
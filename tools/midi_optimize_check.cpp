@@ -0,0 +1,173 @@
+// Checks that the import-time event optimizer (src/midi_smf_optimizer.cpp) leaves
+// what is heard in place: every sounding note-on and note-off, and every change of
+// the CC64-69 switches (sustain, portamento, sostenuto, soft, legato, hold 2), at
+// its original time. Continuous controllers and bends must end on the same value.
+//
+//   midi_optimize_check [song.mid ...]
+//
+// The generated fixtures are always checked, with the default options and with
+// aggressive thinning.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../src/midi_smf_optimizer.h"
+#include "../src/midi_smf_stream.h"
+#include "midi_fixtures.h"
+#include "midi_render.h"
+
+using godot::MidiOptimizeOptions;
+using godot::MidiOptimizeStats;
+
+namespace {
+
+struct CheckCase {
+	std::string name;
+	std::vector<uint8_t> midi_data;
+};
+
+struct TimedValue {
+	uint32_t time;
+	int value;
+
+	bool operator==(const TimedValue &p_other) const { return time == p_other.time && value == p_other.value; }
+};
+
+// What the checks compare, decoded the way the player plays the file.
+struct Decoded {
+	std::vector<TimedValue> notes; // channel << 16 | key << 8 | on, note-offs of silent keys left out
+	std::map<int, std::vector<TimedValue>> switches; // channel << 8 | control -> changes
+	std::map<int, int> last_values; // channel * 512 + control (256: bend, 257: pressure) -> value
+};
+
+bool decode(const std::vector<uint8_t> &p_data, Decoded &r_decoded) {
+	godot::MidiSmfStream stream;
+	if (!stream.open(p_data.data(), p_data.size())) {
+		return false;
+	}
+	int sounding[16][128] = {};
+	while (const tml_message *msg = stream.peek(UINT32_MAX)) {
+		const int channel = msg->channel & 0x0F;
+		switch (msg->type) {
+			case TML_NOTE_ON:
+			case TML_NOTE_OFF: {
+				const int key = msg->key & 0x7F;
+				const bool on = msg->type == TML_NOTE_ON;
+				if (on) {
+					sounding[channel][key]++;
+				} else if (sounding[channel][key] > 0) {
+					sounding[channel][key]--;
+				} else {
+					break;
+				}
+				r_decoded.notes.push_back(TimedValue{ msg->time, (channel << 16) | (key << 8) | (on ? 1 : 0) });
+			} break;
+			case TML_CONTROL_CHANGE: {
+				const int control = msg->control & 0x7F;
+				const int value = msg->control_value & 0x7F;
+				const int id = (channel << 8) | control;
+				if (control >= 64 && control <= 69) {
+					std::vector<TimedValue> &changes = r_decoded.switches[id];
+					if (changes.empty() || changes.back().value != value) {
+						changes.push_back(TimedValue{ msg->time, value });
+					}
+				}
+				r_decoded.last_values[channel * 512 + control] = value;
+			} break;
+			case TML_PITCH_BEND:
+				r_decoded.last_values[channel * 512 + 256] = msg->pitch_bend;
+				break;
+			case TML_CHANNEL_PRESSURE:
+				r_decoded.last_values[channel * 512 + 257] = msg->channel_pressure & 0x7F;
+				break;
+		}
+		stream.pop();
+	}
+	return true;
+}
+
+// Returns the number of failures and prints each one.
+int check(const CheckCase &p_case, const char *p_options_name, const MidiOptimizeOptions &p_options) {
+	std::vector<uint8_t> optimized;
+	MidiOptimizeStats stats;
+	if (!godot::midi_optimize_smf(p_case.midi_data.data(), p_case.midi_data.size(), p_options, optimized, stats)) {
+		printf("FAIL %s (%s): not a Standard MIDI File\n", p_case.name.c_str(), p_options_name);
+		return 1;
+	}
+	Decoded before;
+	Decoded after;
+	if (!decode(p_case.midi_data, before) || !decode(optimized, after)) {
+		printf("FAIL %s (%s): optimized file does not decode\n", p_case.name.c_str(), p_options_name);
+		return 1;
+	}
+
+	int failures = 0;
+	if (!(before.notes == after.notes)) {
+		size_t at = 0;
+		while (at < before.notes.size() && at < after.notes.size() && before.notes[at] == after.notes[at]) {
+			at++;
+		}
+		printf("FAIL %s (%s): notes differ from note %d (%d before, %d after)\n", p_case.name.c_str(), p_options_name,
+				(int)at, (int)before.notes.size(), (int)after.notes.size());
+		failures++;
+	}
+	for (const std::pair<const int, std::vector<TimedValue>> &entry : before.switches) {
+		if (!(after.switches[entry.first] == entry.second)) {
+			printf("FAIL %s (%s): channel %d CC%d changes moved or were lost\n", p_case.name.c_str(), p_options_name,
+					entry.first >> 8, entry.first & 0xFF);
+			failures++;
+		}
+	}
+	if (!(before.last_values == after.last_values)) {
+		printf("FAIL %s (%s): controllers or bends end on a different value\n", p_case.name.c_str(), p_options_name);
+		failures++;
+	}
+	if (!failures) {
+		printf("ok   %s (%s): %lld -> %lld events\n", p_case.name.c_str(), p_options_name,
+				(long long)stats.events_before, (long long)stats.events_after);
+	}
+	return failures;
+}
+
+std::string case_name_from_path(const std::string &p_path) {
+	const size_t slash = p_path.find_last_of("/\\");
+	return slash == std::string::npos ? p_path : p_path.substr(slash + 1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	std::vector<CheckCase> cases;
+	cases.push_back(CheckCase{ "fixture_pedals", midi_fixture_make_pedal_smf(16) });
+	cases.push_back(CheckCase{ "fixture_dense", midi_fixture_make_smf(16, 16) });
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			fprintf(stderr, "usage: midi_optimize_check [song.mid ...]\n");
+			return 1;
+		}
+		CheckCase c;
+		c.name = case_name_from_path(argv[i]);
+		if (!midi_read_file(argv[i], c.midi_data)) {
+			fprintf(stderr, "midi_optimize_check: cannot read %s\n", argv[i]);
+			return 1;
+		}
+		cases.push_back(c);
+	}
+
+	MidiOptimizeOptions aggressive;
+	aggressive.controller_tolerance = 16;
+	aggressive.pitch_bend_tolerance = 1024;
+	aggressive.min_interval_ms = 50.0;
+
+	int failures = 0;
+	for (const CheckCase &c : cases) {
+		failures += check(c, "default", MidiOptimizeOptions());
+		failures += check(c, "aggressive", aggressive);
+	}
+	printf("%d case(s), %d failure(s)\n", (int)cases.size() * 2, failures);
+	return failures ? 1 : 0;
+}
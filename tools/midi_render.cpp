@@ -0,0 +1,223 @@
+#include "midi_render.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "../lib/TinySoundFont/tml.h"
+#include "../lib/TinySoundFont/tsf.h"
+#include "../src/midi_dispatch.h"
+#include "../src/midi_fast_math.h"
+#include "../src/midi_smf_stream.h"
+
+namespace {
+
+void put_u16(std::vector<uint8_t> &r_out, uint32_t p_value) {
+	r_out.push_back((uint8_t)p_value);
+	r_out.push_back((uint8_t)(p_value >> 8));
+}
+
+void put_u32(std::vector<uint8_t> &r_out, uint32_t p_value) {
+	put_u16(r_out, p_value);
+	put_u16(r_out, p_value >> 16);
+}
+
+uint32_t get_u16(const uint8_t *p_data) {
+	return (uint32_t)p_data[0] | ((uint32_t)p_data[1] << 8);
+}
+
+uint32_t get_u32(const uint8_t *p_data) {
+	return get_u16(p_data) | (get_u16(p_data + 2) << 16);
+}
+
+} // namespace
+
+void midi_configure_synth(tsf *p_synth, int p_sample_rate, int p_max_voices) {
+	tsf_set_output(p_synth, TSF_STEREO_INTERLEAVED, p_sample_rate, 0.0f);
+	tsf_set_max_voices(p_synth, p_max_voices);
+	for (int ch = 0; ch < 16; ch++) {
+		tsf_channel_set_presetnumber(p_synth, ch, 0, ch == 9);
+		tsf_channel_midi_control(p_synth, ch, (int)TML_PAN_MSB, 64);
+		tsf_channel_midi_control(p_synth, ch, (int)TML_VOLUME_MSB, 127);
+	}
+}
+
+namespace {
+
+// Event sources for render_song(): an expanded tml_message list or a MidiSmfStream.
+struct ListSource {
+	const tml_message *cursor;
+	uint32_t length_ms = 0;
+
+	explicit ListSource(const tml_message *p_first) :
+			cursor(p_first) {
+		for (const tml_message *m = p_first; m; m = m->next) {
+			length_ms = std::max(length_ms, m->time);
+		}
+	}
+	bool is_finished() const { return !cursor; }
+	bool is_length_known() const { return true; }
+	void process(godot::MidiEventDispatcher &p_dispatcher, tsf *p_synth, uint32_t p_time_ms) {
+		cursor = p_dispatcher.process_until(p_synth, cursor, p_time_ms, false);
+	}
+};
+
+struct StreamSource {
+	godot::MidiSmfStream &stream;
+	uint32_t length_ms = 0;
+
+	explicit StreamSource(godot::MidiSmfStream &p_stream) :
+			stream(p_stream) {}
+	bool is_finished() const { return stream.is_finished(); }
+	bool is_length_known() {
+		length_ms = stream.get_decoded_ms();
+		return stream.is_fully_decoded();
+	}
+	void process(godot::MidiEventDispatcher &p_dispatcher, tsf *p_synth, uint32_t p_time_ms) {
+		p_dispatcher.process_until(p_synth, stream, p_time_ms, false);
+	}
+};
+
+template <typename Source>
+void render_song(tsf *p_synth, Source &p_source, const MidiRenderSettings &p_settings, std::vector<float> &r_interleaved) {
+	tsf_reset(p_synth);
+	midi_configure_synth(p_synth, p_settings.sample_rate, p_settings.max_voices);
+	godot::MidiEventDispatcher dispatcher;
+	dispatcher.voice_cap = p_settings.max_voices;
+	dispatcher.steal_policy = p_settings.steal_policy;
+
+	r_interleaved.clear();
+	if (p_source.is_length_known()) {
+		r_interleaved.reserve((size_t)((p_source.length_ms / 1000.0 + 2.0) * p_settings.sample_rate) * 2);
+	}
+
+	// Same floating-point mode as the player's render scope.
+	godot::MidiDenormalScope denormals;
+	int64_t frames = 0;
+	while (!p_source.is_finished() || tsf_active_voice_count(p_synth) > 0) {
+		// A stream's length is known once its last event is decoded, well before playback reaches it.
+		if (p_source.is_length_known() && frames >= (int64_t)((p_source.length_ms / 1000.0 + p_settings.tail_limit_sec) * p_settings.sample_rate)) {
+			break;
+		}
+		const int block = p_settings.block_frames;
+		// Same timing as MidiPlayer::_pump_audio(): dispatch up to the end of the block, then render it.
+		const double block_end_sec = (double)(frames + block) / (double)p_settings.sample_rate;
+		p_source.process(dispatcher, p_synth, (uint32_t)(block_end_sec * 1000.0));
+
+		const size_t offset = r_interleaved.size();
+		r_interleaved.resize(offset + (size_t)block * 2);
+		tsfx_render_float(p_synth, r_interleaved.data() + offset, block, 0, p_settings.interpolation);
+		frames += block;
+	}
+}
+
+} // namespace
+
+void midi_render_song(tsf *p_synth, const tml_message *p_midi, const MidiRenderSettings &p_settings, std::vector<float> &r_interleaved) {
+	ListSource source(p_midi);
+	render_song(p_synth, source, p_settings, r_interleaved);
+}
+
+void midi_render_song(tsf *p_synth, godot::MidiSmfStream &p_stream, const MidiRenderSettings &p_settings, std::vector<float> &r_interleaved) {
+	p_stream.rewind();
+	StreamSource source(p_stream);
+	render_song(p_synth, source, p_settings, r_interleaved);
+}
+
+bool midi_read_file(const char *p_path, std::vector<uint8_t> &r_data) {
+	FILE *f = fopen(p_path, "rb");
+	if (!f) {
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	r_data.resize(size > 0 ? (size_t)size : 0);
+	const bool ok = size > 0 && fread(r_data.data(), 1, r_data.size(), f) == r_data.size();
+	fclose(f);
+	return ok;
+}
+
+bool midi_write_wav(const char *p_path, const float *p_interleaved, int64_t p_frames, int p_sample_rate, bool p_float) {
+	const uint32_t bytes_per_sample = p_float ? 4 : 2;
+	const uint32_t data_size = (uint32_t)(p_frames * 2 * bytes_per_sample);
+
+	std::vector<uint8_t> out;
+	out.reserve(44 + (size_t)data_size);
+	out.insert(out.end(), { 'R', 'I', 'F', 'F' });
+	put_u32(out, 36 + data_size);
+	out.insert(out.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+	put_u32(out, 16);
+	put_u16(out, p_float ? 3 : 1);
+	put_u16(out, 2);
+	put_u32(out, (uint32_t)p_sample_rate);
+	put_u32(out, (uint32_t)p_sample_rate * 2 * bytes_per_sample);
+	put_u16(out, 2 * bytes_per_sample);
+	put_u16(out, bytes_per_sample * 8);
+	out.insert(out.end(), { 'd', 'a', 't', 'a' });
+	put_u32(out, data_size);
+
+	const int64_t samples = p_frames * 2;
+	for (int64_t i = 0; i < samples; i++) {
+		if (p_float) {
+			uint32_t bits;
+			memcpy(&bits, &p_interleaved[i], 4);
+			put_u32(out, bits);
+		} else {
+			const float clamped = std::max(-1.0f, std::min(1.0f, p_interleaved[i]));
+			put_u16(out, (uint16_t)(int16_t)std::lrint(clamped * 32767.0f));
+		}
+	}
+
+	FILE *f = fopen(p_path, "wb");
+	if (!f) {
+		return false;
+	}
+	const bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+	fclose(f);
+	return ok;
+}
+
+bool midi_read_wav(const char *p_path, std::vector<float> &r_interleaved, int &r_sample_rate) {
+	std::vector<uint8_t> data;
+	if (!midi_read_file(p_path, data) || data.size() < 12 || memcmp(data.data(), "RIFF", 4) || memcmp(data.data() + 8, "WAVE", 4)) {
+		return false;
+	}
+
+	uint32_t format = 0;
+	uint32_t channels = 0;
+	uint32_t bits = 0;
+	size_t pos = 12;
+	while (pos + 8 <= data.size()) {
+		const uint8_t *chunk = data.data() + pos;
+		const uint32_t size = get_u32(chunk + 4);
+		const uint8_t *body = chunk + 8;
+		if (pos + 8 + size > data.size()) {
+			return false;
+		}
+		if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+			format = get_u16(body);
+			channels = get_u16(body + 2);
+			r_sample_rate = (int)get_u32(body + 4);
+			bits = get_u16(body + 14);
+		} else if (!memcmp(chunk, "data", 4)) {
+			if (channels != 2 || !((format == 3 && bits == 32) || (format == 1 && bits == 16))) {
+				return false;
+			}
+			const size_t samples = size / (bits / 8);
+			r_interleaved.resize(samples);
+			for (size_t i = 0; i < samples; i++) {
+				if (format == 3) {
+					const uint32_t value = get_u32(body + i * 4);
+					memcpy(&r_interleaved[i], &value, 4);
+				} else {
+					r_interleaved[i] = (float)(int16_t)get_u16(body + i * 2) / 32767.0f;
+				}
+			}
+			return true;
+		}
+		pos += 8 + size + (size & 1);
+	}
+	return false;
+}
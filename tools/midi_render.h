@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../src/tsf_ext.h"
+
+struct tsf;
+struct tml_message;
+
+namespace godot {
+class MidiSmfStream;
+}
+
+// Offline rendering shared by the native tools. Sequencing goes through
+// MidiEventDispatcher and follows MidiPlayer's pump loop, so a tool render
+// matches what the node produces for the same settings.
+
+struct MidiRenderSettings {
+	int sample_rate = 44100;
+	int block_frames = 64; // MidiPlayer's render block
+	int interpolation = TSFX_INTERP_LINEAR;
+	int max_voices = 256;
+	int steal_policy = TSFX_STEAL_OLDEST;
+	// Rendering stops this long after the last event even if notes still hang.
+	float tail_limit_sec = 10.0f;
+};
+
+// Same channel setup as MidiPlayer::_configure_synth().
+void midi_configure_synth(tsf *p_synth, int p_sample_rate, int p_max_voices);
+
+// Resets p_synth and renders the whole song into r_interleaved (stereo). p_synth
+// must not be used by another thread; make one tsf_copy() per worker.
+void midi_render_song(tsf *p_synth, const tml_message *p_midi, const MidiRenderSettings &p_settings, std::vector<float> &r_interleaved);
+// Same, decoding the file as it plays instead of expanding it first.
+void midi_render_song(tsf *p_synth, godot::MidiSmfStream &p_stream, const MidiRenderSettings &p_settings, std::vector<float> &r_interleaved);
+
+bool midi_read_file(const char *p_path, std::vector<uint8_t> &r_data);
+
+// Stereo WAV, 16-bit PCM or 32-bit float.
+bool midi_write_wav(const char *p_path, const float *p_interleaved, int64_t p_frames, int p_sample_rate, bool p_float);
+// Reads back a stereo WAV written by midi_write_wav() (either format).
+bool midi_read_wav(const char *p_path, std::vector<float> &r_interleaved, int &r_sample_rate);